@@ -0,0 +1,970 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Host-side benchmarks for uiwidgets layout and rendering hot paths. See bench/Makefile.
+//
+// Usage: ./bench [-t <min-millis-per-case>] [name-substring...]
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+// Standard C++ headers must precede uiwidgets.h, whose Arduino.h defines min() and max() macros.
+#include "thread_transport.h"
+#include "uiwidgets.h"
+
+/**
+ * A display that draws nothing, but counts the draw calls issued to it. Text metrics mimic the
+ * built-in TFT_eSPI fonts closely enough for layout. Like a TftDrawTarget, it reports copyRect()
+ * as expensive unless copyCheap is set.
+ */
+class StubDisplay : public DrawTarget {
+public:
+  StubDisplay(int16_t w, int16_t h): DrawTarget(), drawCalls(0), copyCheap(false), _w(w), _h(h),
+      _fontId(1) {};
+
+  uint64_t drawCalls;
+  bool copyCheap;
+
+  virtual int16_t width() { return _w; };
+  virtual int16_t height() { return _h; };
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawCalls++;
+  };
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    drawCalls++;
+  };
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { drawCalls++; };
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { drawCalls++; };
+  virtual void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color) {
+    drawCalls++;
+  };
+  virtual void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color) {
+    drawCalls++;
+  };
+  virtual void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color) {
+    drawCalls++;
+  };
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color) {
+    drawCalls++;
+  };
+  virtual void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) {
+    drawCalls++;
+  };
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY) {
+    // Counted as TftDrawTarget performs it: a read and a write for each buffer-sized group of whole
+    // rows, or for each buffer-sized piece of a wider row.
+    int16_t rowsPerCopy = max((int16_t)1, (int16_t)(TFT_COPY_BUF_PIXELS / w));
+    drawCalls += 2 * ((h + rowsPerCopy - 1) / rowsPerCopy)
+        * ((w + TFT_COPY_BUF_PIXELS - 1) / TFT_COPY_BUF_PIXELS);
+    return true;
+  };
+  virtual bool isCopyCheap() { return copyCheap; };
+
+  virtual void setTextFont(uint8_t fontId) { _fontId = fontId; };
+  virtual void setTextColor(uint16_t fgColor) { };
+  virtual void setTextColor(uint16_t fgColor, uint16_t bgColor) { };
+
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y) {
+    drawCalls++;
+    return textWidth(str, _fontId);
+  };
+  virtual int16_t drawNumber(long val, int16_t x, int16_t y) {
+    drawCalls++;
+    return 6 * charWidth(_fontId);
+  };
+  virtual int16_t drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y) {
+    drawCalls++;
+    return (decimalDigits + 2) * charWidth(_fontId);
+  };
+
+  virtual int16_t textWidth(const char *str, uint8_t fontId) {
+    return NULL == str ? 0 : strlen(str) * charWidth(fontId);
+  };
+  virtual int16_t fontHeight(uint8_t fontId) { return fontId <= 1 ? 8 : 8 * fontId; };
+
+private:
+  static int16_t charWidth(uint8_t fontId) { return fontId <= 1 ? 6 : 4 * fontId; };
+
+  int16_t _w, _h;
+  uint8_t _fontId;
+};
+
+/**
+ * A CanvasDrawTarget that also counts the draw calls issued to it. Calls the canvas makes to
+ * itself (e.g., a fillRect() per character of text) are not counted again.
+ */
+class CountingCanvas : public CanvasDrawTarget {
+public:
+  CountingCanvas(int16_t w, int16_t h): CanvasDrawTarget(w, h), drawCalls(0), _depth(0) {};
+
+  uint64_t drawCalls;
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    _enter();
+    CanvasDrawTarget::fillRect(x, y, w, h, color);
+    _depth--;
+  };
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+    _enter();
+    CanvasDrawTarget::drawRect(x, y, w, h, color);
+    _depth--;
+  };
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color) {
+    _enter();
+    CanvasDrawTarget::fillTriangle(x0, y0, x1, y1, x2, y2, color);
+    _depth--;
+  };
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY) {
+    _enter();
+    bool copied = CanvasDrawTarget::copyRect(x, y, w, h, dstX, dstY);
+    _depth--;
+    return copied;
+  };
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y) {
+    _enter();
+    int16_t width = CanvasDrawTarget::drawString(str, x, y);
+    _depth--;
+    return width;
+  };
+
+private:
+  void _enter() {
+    if (_depth++ == 0) {
+      drawCalls++;
+    }
+  };
+
+  int _depth; // Nesting of counted calls in progress.
+};
+
+typedef std::chrono::steady_clock BenchClock;
+
+static uint32_t minMillis = 250; // Minimum time to run each case for.
+static char **filters = NULL;
+static int numFilters = 0;
+
+static bool selected(const char *name) {
+  if (numFilters == 0) {
+    return true;
+  }
+
+  for (int i = 0; i < numFilters; i++) {
+    if (strstr(name, filters[i]) != NULL) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Run 'op' in batches of doubling size until a batch takes at least minMillis, and report the
+ * time and draw calls per op for that batch.
+ */
+template<typename Display, typename Op>
+static void runBench(const char *name, Display &display, Op op) {
+  if (!selected(name)) {
+    return;
+  }
+
+  op(); // Warm up.
+
+  for (uint64_t iters = 1; ; iters *= 2) {
+    uint64_t startCalls = display.drawCalls;
+    BenchClock::time_point start = BenchClock::now();
+    for (uint64_t i = 0; i < iters; i++) {
+      op();
+    }
+    BenchClock::duration elapsed = BenchClock::now() - start;
+
+    uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    if (nanos >= (uint64_t)minMillis * 1000000 || iters >= (1ull << 40)) {
+      printf("%-40s %12.1f ns/op %10.1f draws/op %12llu ops\n", name, (double)nanos / iters,
+          (double)(display.drawCalls - startCalls) / iters, (unsigned long long)iters);
+      return;
+    }
+  }
+}
+
+/** A Rows of 'numRows' Cols, each holding 'numCols' IntLabels. */
+class LabelMatrix {
+public:
+  LabelMatrix(uint16_t numRows, uint16_t numCols): rows(numRows), _numRows(numRows),
+      _numCols(numCols) {
+    _cols = new Cols*[numRows];
+    _labels = new IntLabel[numRows * numCols];
+    for (uint16_t r = 0; r < numRows; r++) {
+      _cols[r] = new Cols(numCols);
+      rows.setRow(r, _cols[r], EQUAL);
+      for (uint16_t c = 0; c < numCols; c++) {
+        IntLabel *label = &_labels[r * numCols + c];
+        label->setValue(r * numCols + c);
+        _cols[r]->setColumn(c, label, EQUAL);
+      }
+    }
+  };
+
+  ~LabelMatrix() {
+    for (uint16_t r = 0; r < _numRows; r++) {
+      delete _cols[r];
+    }
+    delete[] _cols;
+    delete[] _labels;
+  };
+
+  IntLabel &label(uint16_t r, uint16_t c) { return _labels[r * _numCols + c]; };
+
+  Rows rows;
+
+private:
+  uint16_t _numRows, _numCols;
+  Cols **_cols;
+  IntLabel *_labels;
+};
+
+static void benchLayout(StubDisplay &display) {
+  LabelMatrix grid(8, 8);
+  runBench("layout/cascade rows x cols 8x8", display, [&]() {
+    grid.rows.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  LabelMatrix tall(64, 1);
+  runBench("layout/cascade rows x cols 64x1", display, [&]() {
+    tall.rows.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  LabelMatrix wide(1, 64);
+  runBench("layout/cascade rows x cols 1x64", display, [&]() {
+    wide.rows.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  // The same 8x8 labels in a single Grid, laid out in one pass.
+  Grid flat(8, 8);
+  IntLabel flatLabels[64];
+  for (uint16_t i = 0; i < 64; i++) {
+    flatLabels[i].setValue(i);
+    flat.setCell(i / 8, i % 8, &flatLabels[i]);
+  }
+  flat.setFixedHeight(EQUAL);
+  flat.setFixedWidth(EQUAL);
+  runBench("layout/cascade grid 8x8", display, [&]() {
+    flat.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  // The same 8x8 labels in a StaticLayout, whose rects are fixed ahead of time. (A real screen
+  // would compute them with constexpr evaluation; here they're computed once at startup.)
+  static const int16_t equal8[] = { EQUAL, EQUAL, EQUAL, EQUAL, EQUAL, EQUAL, EQUAL, EQUAL };
+  UIRect screenRect = { 0, 0, display.width(), display.height() };
+  UIRect staticRects[64];
+  UIWidget *staticChildren[64];
+  for (uint16_t i = 0; i < 64; i++) {
+    staticRects[i] = layoutCol(layoutRow(screenRect, equal8, 8, i / 8), equal8, 8, i % 8);
+    staticChildren[i] = &flatLabels[i];
+  }
+  StaticLayout fixedLayout(staticChildren, staticRects, 64);
+  runBench("layout/cascade static 8x8", display, [&]() {
+    fixedLayout.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  // FLEX columns are sized to their labels' text, which is measured once and then cached.
+  Cols flexCols(16);
+  IntLabel flexLabels[16];
+  for (uint16_t c = 0; c < 16; c++) {
+    flexLabels[c].setValue(c * 1000);
+    flexCols.setColumn(c, &flexLabels[c], FLEX);
+  }
+  Screen flexScreen(display);
+  flexScreen.setWidget(&flexCols);
+  runBench("layout/cascade flex cols 16", display, [&]() {
+    flexCols.setBoundingBox(0, 0, display.width(), display.height());
+  });
+
+  // A new value only lays the tree out again if it changes the width of a FLEX column.
+  long flexValue = 0;
+  runBench("layout/flex setValue, same width", display, [&]() {
+    flexLabels[8].setValue(8000 + flexValue++ % 1000);
+    flexScreen.updateLayout();
+  });
+
+  runBench("layout/flex setValue, new width", display, [&]() {
+    flexLabels[8].setValue(flexValue++ % 2 ? 8 : 8000);
+    flexScreen.updateLayout();
+  });
+
+  // Populating a container only marks it for layout; the Screen lays it out once afterward.
+  Rows rows(64);
+  IntLabel labels[64];
+  Screen screen(display);
+  screen.setWidget(&rows);
+  runBench("layout/fill 64 rows + updateLayout", display, [&]() {
+    for (uint16_t r = 0; r < 64; r++) {
+      rows.setRow(r, &labels[r], EQUAL);
+    }
+    screen.updateLayout();
+  });
+}
+
+static void benchRender(StubDisplay &display) {
+  LabelMatrix grid(8, 8);
+  grid.label(3, 3).setBackground(TFT_BLUE);
+  grid.label(4, 4).setBorder(BORDER_RECT);
+
+  Screen screen(display);
+  screen.setWidget(&grid.rows);
+  runBench("render/full screen 8x8 labels", display, [&]() {
+    screen.render();
+  });
+
+  runBench("render/renderWidget 1 of 8x8", display, [&]() {
+    screen.renderWidget(&grid.label(4, 4));
+  });
+
+  UIRect area = { 100, 70, 120, 60 }; // Spans parts of 3 rows of labels.
+  runBench("render/renderRect across siblings", display, [&]() {
+    screen.renderRect(area);
+  });
+
+  Grid flat(8, 8);
+  IntLabel flatLabels[64];
+  for (uint16_t i = 0; i < 64; i++) {
+    flatLabels[i].setValue(i);
+    flat.setCell(i / 8, i % 8, &flatLabels[i]);
+  }
+  flat.setFixedHeight(EQUAL);
+  flat.setFixedWidth(EQUAL);
+  flatLabels[4 * 8 + 4].setBorder(BORDER_RECT);
+  Screen flatScreen(display);
+  flatScreen.setWidget(&flat);
+  runBench("render/renderWidget 1 of grid 8x8", display, [&]() {
+    flatScreen.renderWidget(&flatLabels[4 * 8 + 4]);
+  });
+
+  runBench("render/invalidate+flush row of 8", display, [&]() {
+    for (uint16_t c = 0; c < 8; c++) {
+      screen.invalidate(&grid.label(2, c));
+    }
+    screen.flush();
+  });
+}
+
+/**
+ * Nest 'depth' single-element containers (alternating Rows and Cols) around a label, and redraw
+ * just the label.
+ */
+static void benchDeepTree(StubDisplay &display, uint16_t depth, const char *name) {
+  UIWidget **containers = new UIWidget*[depth];
+  StrLabel leaf("leaf");
+
+  UIWidget *child = &leaf;
+  for (uint16_t i = depth; i > 0; i--) {
+    if (i % 2 == 0) {
+      Rows *rows = new Rows(1);
+      rows->setRow(0, child, EQUAL);
+      containers[i - 1] = rows;
+    } else {
+      Cols *cols = new Cols(1);
+      cols->setColumn(0, child, EQUAL);
+      containers[i - 1] = cols;
+    }
+    child = containers[i - 1];
+  }
+  containers[depth / 2]->setBackground(TFT_BLUE);
+
+  Screen screen(display);
+  screen.setWidget(containers[0]);
+  runBench(name, display, [&]() {
+    screen.renderWidget(&leaf);
+  });
+
+  for (uint16_t i = 0; i < depth; i++) {
+    delete containers[i];
+  }
+  delete[] containers;
+}
+
+template<typename Display>
+static void benchVScroll(Display &display, size_t numEntries, const char *name,
+    uint32_t renderFlags=RF_NONE) {
+  VScroll vscroll;
+  vscroll.setContentBackground(TFT_BLUE);
+  StrLabel *entries = new StrLabel[numEntries];
+  for (size_t i = 0; i < numEntries; i++) {
+    entries[i].setText("entry");
+    vscroll.add(&entries[i]);
+  }
+
+  Screen screen(display);
+  screen.setWidget(&vscroll);
+  screen.render();
+  runBench(name, display, [&]() {
+    if (!vscroll.scrollDown()) {
+      vscroll.scrollTo(0);
+    }
+    screen.renderWidget(&vscroll, renderFlags);
+  });
+
+  delete[] entries;
+}
+
+/**
+ * Scroll with RF_VSCROLL_SHIFT where moving pixels is cheap (on a canvas, which moves them with
+ * memmove()) against redrawing the list each time; and on a display that reads pixels back to
+ * move them, as a TftDrawTarget does if told its copies are cheap. (By default the StubDisplay,
+ * like a TftDrawTarget, says they are not, and the "scroll+shift" case above redraws.)
+ */
+static void benchVScrollShift(StubDisplay &display) {
+  CountingCanvas canvas(display.width(), display.height());
+  benchVScroll(canvas, 1000, "vscroll/canvas scroll+redraw 1k", RF_NONE);
+  benchVScroll(canvas, 1000, "vscroll/canvas scroll+shift 1k", RF_VSCROLL_SHIFT);
+
+  StubDisplay readback(display.width(), display.height());
+  readback.copyCheap = true;
+  benchVScroll(readback, 1000, "vscroll/readback scroll+shift 1k", RF_VSCROLL_SHIFT);
+}
+
+/**
+ * Scroll back and forth by one entry at the top and at the bottom of a 10k-entry VScroll, which
+ * should cost the same; and remove and re-insert a visible entry by pointer.
+ */
+static void benchVScrollEnds(StubDisplay &display) {
+  const size_t numEntries = 10000;
+  VScroll vscroll;
+  StrLabel *entries = new StrLabel[numEntries];
+  for (size_t i = 0; i < numEntries; i++) {
+    entries[i].setText("entry");
+    vscroll.add(&entries[i]);
+  }
+
+  Screen screen(display);
+  screen.setWidget(&vscroll);
+  screen.render();
+  bool down = true;
+  runBench("vscroll/scroll at top of 10k", display, [&]() {
+    if (down) {
+      vscroll.scrollDown();
+    } else {
+      vscroll.scrollUp();
+    }
+    down = !down;
+    screen.renderWidget(&vscroll);
+  });
+
+  while (vscroll.scrollDown()) {
+  }
+  down = false; // Scroll up first; this is as far down as it goes.
+  runBench("vscroll/scroll at bottom of 10k", display, [&]() {
+    if (down) {
+      vscroll.scrollDown();
+    } else {
+      vscroll.scrollUp();
+    }
+    down = !down;
+    screen.renderWidget(&vscroll);
+  });
+
+  UIWidget *visible = &entries[numEntries - 5];
+  runBench("vscroll/remove+insert visible of 10k", display, [&]() {
+    vscroll.remove(visible);
+    vscroll.insert(numEntries - 5, visible);
+    screen.updateLayout();
+  });
+
+  screen.setWidget(NULL);
+  delete[] entries;
+}
+
+/**
+ * Check that removing entries from a VScroll keeps the entry at the top in view when the removed
+ * ones are above it, and scrolls up to keep the last page full when they are near the end. Both
+ * are checked with uniform heights and with differing ones.
+ */
+static void checkVScrollRemove(StubDisplay &display) {
+  const char *name = "vscroll/removeAt keeps top entry";
+  if (!selected(name)) {
+    return;
+  }
+
+  const size_t numEntries = 100;
+  const char *problem = NULL;
+  for (int mixed = 0; mixed < 2 && NULL == problem; mixed++) {
+    VScroll vscroll;
+    StrLabel *entries = new StrLabel[numEntries];
+    for (size_t i = 0; i < numEntries; i++) {
+      entries[i].setText("entry");
+      vscroll.add(&entries[i]);
+      if (mixed) {
+        vscroll.setEntryHeight(i, 16 + 8 * (i % 3));
+      }
+    }
+
+    Screen screen(display);
+    screen.setWidget(&vscroll);
+    vscroll.scrollTo(50);
+    vscroll.removeAt(10, 5); // Above the top entry.
+    if (screen.widgetAt(1, 1) != &entries[50]) {
+      problem = "top entry moved";
+    }
+
+    while (vscroll.scrollDown()) {
+    }
+    vscroll.removeAt(numEntries - 5 - 8, 8); // Includes the top entry.
+    screen.updateLayout();
+    size_t top = vscroll.indexOf(screen.widgetAt(1, 1));
+    if (NULL == problem && top >= numEntries - 5 - 8) {
+      problem = "top entry past the end";
+    } else if (NULL == problem && vscroll.scrollDown()) {
+      problem = "last page not full";
+    } else if (NULL == problem && (!vscroll.scrollUp() || !vscroll.scrollDown())) {
+      problem = "scrolled up too far";
+    }
+
+    screen.setWidget(NULL);
+    delete[] entries;
+  }
+
+  if (NULL != problem) {
+    printf("ERROR: %-33s %s\n", name, problem);
+  } else {
+    printf("%-40s ok\n", name);
+  }
+}
+
+/**
+ * Check that redrawing a VScroll with RF_VSCROLL_SHIFT, merged with selection changes through
+ * invalidate() and flush(), leaves the screen exactly as a full render() does. Entries have
+ * backgrounds and differing heights, and the selection moves as the list scrolls both ways.
+ */
+static void checkVScrollShift(StubDisplay &display) {
+  const char *name = "vscroll/shift matches full render";
+  if (!selected(name)) {
+    return;
+  }
+
+  const size_t numEntries = 60;
+  CanvasDrawTarget shifted(display.width(), display.height());
+  CanvasDrawTarget full(display.width(), display.height());
+  VScroll shiftList, fullList;
+  StrLabel *entries = new StrLabel[2 * numEntries];
+  VScroll *lists[] = { &shiftList, &fullList };
+  for (int l = 0; l < 2; l++) {
+    lists[l]->setContentBackground(TFT_BLUE);
+    for (size_t i = 0; i < numEntries; i++) {
+      StrLabel &entry = entries[l * numEntries + i];
+      entry.setText("entry");
+      if (i % 2 == 0) {
+        entry.setBackground(TFT_RED);
+      }
+      lists[l]->add(&entry);
+      lists[l]->setEntryHeight(i, 16 + 8 * (i % 3));
+    }
+  }
+
+  Screen shiftScreen(shifted), fullScreen(full);
+  shiftScreen.setWidget(&shiftList);
+  fullScreen.setWidget(&fullList);
+  shiftScreen.render();
+
+  uint32_t badPixels = 0;
+  for (int step = 0; step < 200; step++) {
+    bool down = (step / 40) % 2 == 0;
+    for (int l = 0; l < 2; l++) {
+      if (step % 3 == 0) {
+        if (down) {
+          lists[l]->selectDown();
+        } else {
+          lists[l]->selectUp();
+        }
+      }
+      if (down) {
+        lists[l]->scrollDown();
+      } else {
+        lists[l]->scrollUp();
+      }
+    }
+
+    if (step % 3 == 0) {
+      shiftScreen.invalidate(&shiftList, RF_VSCROLL_SELECTED);
+    }
+    shiftScreen.invalidate(&shiftList, RF_VSCROLL_SHIFT);
+    shiftScreen.flush();
+    fullScreen.render();
+
+    for (int32_t i = 0; i < (int32_t)display.width() * display.height(); i++) {
+      badPixels += shifted.getPixels()[i] != full.getPixels()[i] ? 1 : 0;
+    }
+  }
+
+  if (badPixels > 0) {
+    printf("ERROR: %-33s %u pixels differ\n", name, (unsigned)badPixels);
+  } else {
+    printf("%-40s ok\n", name);
+  }
+
+  shiftScreen.setWidget(NULL);
+  fullScreen.setWidget(NULL);
+  delete[] entries;
+}
+
+/**
+ * Scroll and hit-test a VScroll of 10k entries in three different heights, in the middle of the
+ * list, and change the height of one entry near its top.
+ */
+static void benchVariableVScroll(StubDisplay &display) {
+  const size_t numEntries = 10000;
+  VScroll vscroll;
+  vscroll.setContentBackground(TFT_BLUE);
+  StrLabel *entries = new StrLabel[numEntries];
+  for (size_t i = 0; i < numEntries; i++) {
+    entries[i].setText("entry");
+    vscroll.add(&entries[i]);
+    vscroll.setEntryHeight(i, 16 * (1 + i % 3));
+  }
+
+  Screen screen(display);
+  screen.setWidget(&vscroll);
+  vscroll.scrollTo(numEntries / 2);
+  screen.render();
+  bool down = true;
+  runBench("vscroll/scroll+shift 10k mixed heights", display, [&]() {
+    if (down) {
+      vscroll.scrollDown();
+    } else {
+      vscroll.scrollUp();
+    }
+    down = !down;
+    screen.renderWidget(&vscroll, RF_VSCROLL_SHIFT);
+  });
+
+  uint16_t next = 0;
+  runBench("hit/widgetAt vscroll 10k mixed heights", display, [&]() {
+    screen.widgetAt(10, (next * 53) % display.height());
+    next = (next + 1) % 64;
+  });
+
+  runBench("vscroll/setEntryHeight of 10k", display, [&]() {
+    vscroll.setEntryHeight(1, 16 + next);
+    next = (next + 1) % 64;
+    screen.updateLayout();
+  });
+
+  screen.setWidget(NULL);
+  delete[] entries;
+}
+
+/** Supplies "entry" for every entry of a virtualized VScroll. */
+class BenchAdapter : public VScrollAdapter {
+public:
+  BenchAdapter(size_t numEntries): VScrollAdapter(), _numEntries(numEntries) {};
+
+  virtual size_t count() { return _numEntries; };
+  virtual void bindRow(UIWidget *row, size_t idx) { static_cast<StrLabel*>(row)->setText("entry"); };
+
+private:
+  size_t _numEntries;
+};
+
+// As benchVScroll(), but with a VScroll that recycles 16 rows for its visible entries.
+static void benchVirtualScroll(StubDisplay &display, size_t numEntries, const char *name) {
+  BenchAdapter adapter(numEntries);
+  StrLabel rows[16];
+  UIWidget *rowPtrs[16];
+  for (size_t i = 0; i < 16; i++) {
+    rowPtrs[i] = &rows[i];
+  }
+
+  VScroll vscroll;
+  vscroll.setAdapter(&adapter, rowPtrs, 16);
+
+  Screen screen(display);
+  screen.setWidget(&vscroll);
+  screen.render();
+  runBench(name, display, [&]() {
+    if (!vscroll.scrollDown()) {
+      vscroll.scrollTo(0);
+    }
+    screen.renderWidget(&vscroll);
+  });
+}
+
+/** Find the widget under a sequence of points, as for touch input. */
+static void benchHitTest(StubDisplay &display) {
+  // Points spread over the screen, stepping by amounts coprime with its size.
+  static const uint16_t NUM_POINTS = 64;
+  int16_t xs[NUM_POINTS], ys[NUM_POINTS];
+  for (uint16_t i = 0; i < NUM_POINTS; i++) {
+    xs[i] = (i * 37) % display.width();
+    ys[i] = (i * 53) % display.height();
+  }
+
+  LabelMatrix grid(8, 8);
+  Screen screen(display);
+  screen.setWidget(&grid.rows);
+  uint16_t next = 0;
+  runBench("hit/widgetAt rows x cols 8x8", display, [&]() {
+    screen.widgetAt(xs[next], ys[next]);
+    next = (next + 1) % NUM_POINTS;
+  });
+
+  Grid flat(8, 8);
+  IntLabel flatLabels[64];
+  for (uint16_t i = 0; i < 64; i++) {
+    flat.setCell(i / 8, i % 8, &flatLabels[i]);
+  }
+  flat.setFixedHeight(EQUAL);
+  flat.setFixedWidth(EQUAL);
+  screen.setWidget(&flat);
+  runBench("hit/widgetAt grid 8x8", display, [&]() {
+    screen.widgetAt(xs[next], ys[next]);
+    next = (next + 1) % NUM_POINTS;
+  });
+
+  VScroll vscroll;
+  StrLabel *entries = new StrLabel[1000];
+  for (size_t i = 0; i < 1000; i++) {
+    vscroll.add(&entries[i]);
+  }
+  vscroll.scrollTo(500);
+  screen.setWidget(&vscroll);
+  runBench("hit/widgetAt vscroll 1k", display, [&]() {
+    screen.widgetAt(xs[next], ys[next]);
+    next = (next + 1) % NUM_POINTS;
+  });
+
+  screen.setWidget(NULL);
+  delete[] entries;
+}
+
+/**
+ * Build and tear down a Rows of 8 Cols of 8 IntLabels, and an 8x8 Grid of them: with a `new` for
+ * each widget, or out of a WidgetArena that is reset afterward.
+ */
+static void benchBuild(StubDisplay &display) {
+  runBench("build/new 8x8 labels + delete", display, [&]() {
+    Rows *rows = new Rows(8);
+    Cols *cols[8];
+    IntLabel *labels[64];
+    for (uint16_t r = 0; r < 8; r++) {
+      cols[r] = new Cols(8);
+      rows->setRow(r, cols[r], EQUAL);
+      for (uint16_t c = 0; c < 8; c++) {
+        labels[r * 8 + c] = new IntLabel(r * 8 + c);
+        cols[r]->setColumn(c, labels[r * 8 + c], EQUAL);
+      }
+    }
+
+    for (uint16_t i = 0; i < 64; i++) {
+      delete labels[i];
+    }
+    for (uint16_t r = 0; r < 8; r++) {
+      delete cols[r];
+    }
+    delete rows;
+  });
+
+  WidgetArena arena(16384);
+  const char *arenaName = "build/arena 8x8 labels + reset";
+  runBench(arenaName, display, [&]() {
+    Rows *rows = arena.createRows(8);
+    for (uint16_t r = 0; r < 8; r++) {
+      Cols *cols = arena.createCols(8);
+      rows->setRow(r, cols, EQUAL);
+      for (uint16_t c = 0; c < 8; c++) {
+        cols->setColumn(c, arena.create<IntLabel>(r * 8 + c), EQUAL);
+      }
+    }
+
+    arena.reset();
+  });
+  if (selected(arenaName)) {
+    printf("  (arena high-water mark: %u bytes)\n", (unsigned)arena.getHighWater());
+  }
+
+  runBench("build/new grid 8x8 + delete", display, [&]() {
+    Grid *grid = new Grid(8, 8);
+    IntLabel *labels[64];
+    for (uint16_t i = 0; i < 64; i++) {
+      labels[i] = new IntLabel(i);
+      grid->setCell(i / 8, i % 8, labels[i]);
+    }
+
+    for (uint16_t i = 0; i < 64; i++) {
+      delete labels[i];
+    }
+    delete grid;
+  });
+
+  arena.clearHighWater();
+  const char *arenaGridName = "build/arena grid 8x8 + reset";
+  runBench(arenaGridName, display, [&]() {
+    Grid *grid = arena.createGrid(8, 8);
+    for (uint16_t i = 0; i < 64; i++) {
+      grid->setCell(i / 8, i % 8, arena.create<IntLabel>(i));
+    }
+
+    arena.reset();
+  });
+  if (selected(arenaGridName)) {
+    printf("  (arena high-water mark: %u bytes)\n", (unsigned)arena.getHighWater());
+  }
+}
+
+/**
+ * A widget that shades each of its pixels from 16 samples of a pattern of rings, standing in for
+ * raster-heavy content (anti-aliased fonts, images, charts) that takes a while to draw. Only the
+ * lines within the clip rect are shaded, so each band costs its share.
+ */
+class ShadedWidget : public UIWidget {
+public:
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags) {
+    const int samples = 4;
+    for (int16_t y = _y; y < _y + _h; y++) {
+      UIRect line = { _x, y, _w, 1 };
+      if (!lcd.intersectsClip(line)) {
+        continue;
+      }
+
+      for (int16_t x = _x; x < _x + _w; x++) {
+        uint32_t level = 0;
+        for (int s = 0; s < samples * samples; s++) {
+          float dx = x - _w / 2 + (s % samples + 0.5f) / samples;
+          float dy = y - _h / 2 + (s / samples + 0.5f) / samples;
+          level += ((int)sqrtf(dx * dx + dy * dy) / 8) % 2;
+        }
+        uint16_t shade = level * 31 / (samples * samples);
+        lcd.drawFastHLine(x, y, 1, (shade << 11) | shade);
+      }
+    }
+  };
+
+  virtual int16_t getContentWidth(DrawTarget &lcd) const { return 0; };
+  virtual int16_t getContentHeight(DrawTarget &lcd) const { return 0; };
+};
+
+/**
+ * Render 'widget' full screen, off-screen in 16-line bands, through a TftDrawTarget whose sprites
+ * are pushed by a simulated SPI transfer at 'bitsPerSecond': synchronously, or on a background
+ * thread while the next band is drawn. Overlapping the two saves up to the smaller of the drawing
+ * and transfer times. 'names' are for the cases with no push (measuring drawing alone, as the stub
+ * display takes no time), a synchronous push, and a DMA push.
+ */
+static void benchPipelineCase(StubDisplay &display, UIWidget *widget, const char *names[3],
+    uint32_t bitsPerSecond) {
+  TFT_eSPI lcd(display.width(), display.height());
+  ThreadTransport syncPush(lcd.width(), lcd.height(), bitsPerSecond, false);
+  ThreadTransport dmaPush(lcd.width(), lcd.height(), bitsPerSecond, true);
+
+  ThreadTransport *transports[] = { NULL, &syncPush, &dmaPush };
+  for (int i = 0; i < 3; i++) {
+    TftDrawTarget target(lcd, transports[i]);
+    Screen screen(target);
+    screen.setWidget(widget);
+    screen.setOffscreenRendering(true);
+    screen.setBandHeight(16);
+    runBench(names[i], display, [&]() {
+      screen.render();
+    });
+    screen.setWidget(NULL);
+  }
+
+  if (selected(names[1]) && selected(names[2]) && memcmp(syncPush.getFrameBuffer(),
+      dmaPush.getFrameBuffer(), (size_t)lcd.width() * lcd.height() * sizeof(uint16_t)) != 0) {
+    printf("ERROR: DMA-pushed frame differs from synchronously pushed frame\n");
+  }
+}
+
+/**
+ * Render a grid of labels, which is quick to draw, and a shaded screen, which takes about as long
+ * to draw on this host as it does to send at 160 Mbit/s. (A microcontroller draws far slower, so
+ * there drawing and sending over a 40 Mbit/s bus are comparable.) The DMA push only gains much in
+ * the second case.
+ *
+ * Also check that a band sprite kept from a full-width render, and reused for a narrower area,
+ * pushes that area correctly.
+ */
+static void benchPipeline(StubDisplay &display) {
+  LabelMatrix grid(8, 8);
+  grid.rows.setBackground(TFT_BLUE);
+  grid.label(4, 4).setBorder(BORDER_RECT);
+  const char *gridNames[] = { "pipeline/banded render, no push",
+      "pipeline/banded render, sync push", "pipeline/banded render, DMA push" };
+  benchPipelineCase(display, &grid.rows, gridNames, 40000000);
+
+  ShadedWidget shaded;
+  const char *shadedNames[] = { "pipeline/shaded render, no push",
+      "pipeline/shaded render, sync push", "pipeline/shaded render, DMA push" };
+  benchPipelineCase(display, &shaded, shadedNames, 160000000);
+
+  const char *name = "pipeline/reused sprite matches new one";
+  if (!selected(name)) {
+    return;
+  }
+
+  TFT_eSPI lcd(display.width(), display.height());
+  ThreadTransport reused(lcd.width(), lcd.height(), 4000000000u, false);
+  ThreadTransport fresh(lcd.width(), lcd.height(), 4000000000u, false);
+  TftDrawTarget reusedTarget(lcd, &reused);
+  Screen screen(reusedTarget);
+  screen.setWidget(&grid.rows);
+  screen.setOffscreenRendering(true);
+  screen.setBandHeight(16);
+  screen.render();
+  grid.label(4, 4).setValue(12345);
+  screen.invalidate(&grid.label(4, 4));
+  screen.flush();
+  screen.setWidget(NULL);
+
+  TftDrawTarget freshTarget(lcd, &fresh);
+  Screen freshScreen(freshTarget);
+  freshScreen.setWidget(&grid.rows);
+  freshScreen.setOffscreenRendering(true);
+  freshScreen.setBandHeight(16);
+  freshScreen.render();
+  freshScreen.setWidget(NULL);
+
+  if (memcmp(reused.getFrameBuffer(), fresh.getFrameBuffer(),
+      (size_t)lcd.width() * lcd.height() * sizeof(uint16_t)) != 0) {
+    printf("ERROR: %-33s frames differ\n", name);
+  } else {
+    printf("%-40s ok\n", name);
+  }
+}
+
+int main(int argc, char **argv) {
+  int argi = 1;
+  if (argi + 1 < argc && strcmp(argv[argi], "-t") == 0) {
+    minMillis = atoi(argv[argi + 1]);
+    argi += 2;
+  }
+  filters = argv + argi;
+  numFilters = argc - argi;
+
+  StubDisplay display(320, 240);
+
+  benchLayout(display);
+  benchRender(display);
+  benchDeepTree(display, 8, "redraw/renderWidget depth 8");
+  benchDeepTree(display, 64, "redraw/renderWidget depth 64");
+  benchVScroll(display, 10, "vscroll/scroll+redraw 10 entries");
+  benchVScroll(display, 1000, "vscroll/scroll+redraw 1k entries");
+  benchVScroll(display, 1000, "vscroll/scroll+shift 1k entries", RF_VSCROLL_SHIFT);
+  benchVScrollShift(display);
+  benchVScroll(display, 100000, "vscroll/scroll+redraw 100k entries");
+  benchVirtualScroll(display, 100000, "vscroll/scroll+redraw 100k virtual");
+  benchVScrollEnds(display);
+  benchVariableVScroll(display);
+  checkVScrollRemove(display);
+  checkVScrollShift(display);
+  benchHitTest(display);
+  benchBuild(display);
+  benchPipeline(display);
+
+  return 0;
+}
@@ -0,0 +1,36 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// Minimal stand-in for the Arduino core, sufficient to compile uiwidgets on a host machine.
+
+#ifndef __UIW_BENCH_ARDUINO_H
+#define __UIW_BENCH_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef min
+#define min(a, b) ((a) < (b) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a, b) ((a) > (b) ? (a) : (b))
+#endif
+
+unsigned long micros();
+unsigned long millis();
+void delay(unsigned long ms);
+
+// Only the parts of String that uiwidgets uses.
+class String {
+public:
+  String(const char *str=""): _str(str) {};
+  const char *c_str() const { return _str; };
+
+private:
+  const char *_str;
+};
+
+#endif // __UIW_BENCH_ARDUINO_H
@@ -0,0 +1,170 @@
+// (c) Copyright 2022 Aaron Kimball
+//
+// A display-less stand-in for TFT_eSPI, with the interface uiwidgets uses. The TFT_eSPI display
+// itself draws nothing; a TFT_eSprite rasterizes into (and reads back from) its own pixel buffer
+// (storing colors with their bytes swapped, as the real one does), so off-screen drawing costs CPU
+// time much as it does on a device. Text is drawn as one solid block per character of a 6x8 (times font id) cell.
+
+#ifndef __UIW_BENCH_TFT_ESPI_H
+#define __UIW_BENCH_TFT_ESPI_H
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+#define TFT_BLACK       0x0000
+#define TFT_BLUE        0x001F
+#define TFT_RED         0xF800
+#define TFT_GREEN       0x07E0
+#define TFT_YELLOW      0xFFE0
+#define TFT_WHITE       0xFFFF
+#define TFT_TRANSPARENT 0x0120
+
+class TFT_eSPI {
+public:
+  TFT_eSPI(int16_t w=320, int16_t h=240): _w(w), _h(h), _fontId(1), _textFg(TFT_WHITE),
+      _textBg(TFT_WHITE), _swapBytes(false) {};
+  virtual ~TFT_eSPI() {};
+
+  int16_t width() { return _w; };
+  int16_t height() { return _h; };
+
+  // Primitives that a TFT_eSprite overrides to draw into its buffer.
+  virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {};
+  virtual void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {};
+  virtual void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {};
+  virtual void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) {};
+  // The display has no pixels to read; this reads black.
+  virtual void readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) {
+    memset(data, 0, (size_t)w * h * sizeof(uint16_t));
+  };
+
+  void setSwapBytes(bool swap) { _swapBytes = swap; };
+  bool getSwapBytes() { return _swapBytes; };
+
+  void fillScreen(uint32_t color) { fillRect(0, 0, _w, _h, color); };
+  void drawRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    drawFastHLine(x, y, w, color);
+    drawFastHLine(x, y + h - 1, w, color);
+    drawFastVLine(x, y, h, color);
+    drawFastVLine(x + w - 1, y, h, color);
+  };
+  void drawRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color) {
+    drawRect(x, y, w, h, color);
+  };
+  void fillRoundRect(int32_t x, int32_t y, int32_t w, int32_t h, int32_t r, uint32_t color) {
+    fillRect(x, y, w, h, color);
+  };
+  // Triangles are approximated by their bounding boxes.
+  void drawTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+      uint32_t color) {
+    int32_t x = min(x0, min(x1, x2)), y = min(y0, min(y1, y2));
+    drawRect(x, y, max(x0, max(x1, x2)) - x + 1, max(y0, max(y1, y2)) - y + 1, color);
+  };
+  void fillTriangle(int32_t x0, int32_t y0, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+      uint32_t color) {
+    int32_t x = min(x0, min(x1, x2)), y = min(y0, min(y1, y2));
+    fillRect(x, y, max(x0, max(x1, x2)) - x + 1, max(y0, max(y1, y2)) - y + 1, color);
+  };
+
+  void setTextFont(uint8_t font) { _fontId = font; };
+  void setTextColor(uint16_t fg) { _textFg = fg; _textBg = fg; };
+  void setTextColor(uint16_t fg, uint16_t bg) { _textFg = fg; _textBg = bg; };
+
+  int16_t drawString(const char *str, int32_t x, int32_t y) {
+    int16_t cw = charWidth(_fontId), ch = fontHeight(_fontId);
+    int16_t w = 0;
+    for (const char *p = str; *p != '\0'; p++, w += cw) {
+      if (_textBg != _textFg) {
+        fillRect(x + w, y, cw, ch, _textBg);
+      }
+      if (*p != ' ') {
+        fillRect(x + w, y, cw - 1, ch - 1, _textFg);
+      }
+    }
+    return w;
+  };
+  int16_t drawNumber(long val, int32_t x, int32_t y) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), "%ld", val);
+    return drawString(buf, x, y);
+  };
+  int16_t drawFloat(float val, uint8_t dp, int32_t x, int32_t y) {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", (int)dp, (double)val);
+    return drawString(buf, x, y);
+  };
+  int16_t textWidth(const char *str, uint8_t font=1) { return strlen(str) * charWidth(font); };
+  int16_t fontHeight(int16_t font=1) { return 8 * max(font, (int16_t)1); };
+
+protected:
+  static int16_t charWidth(uint8_t font) { return 6 * max(font, (uint8_t)1); };
+
+  int16_t _w, _h;
+  uint8_t _fontId;
+  uint16_t _textFg, _textBg;
+  bool _swapBytes;
+};
+
+class TFT_eSprite : public TFT_eSPI {
+public:
+  TFT_eSprite(TFT_eSPI *tft): TFT_eSPI(0, 0), _tft(tft), _pixels(NULL) {};
+  virtual ~TFT_eSprite() { deleteSprite(); };
+
+  void *createSprite(int16_t w, int16_t h, uint8_t frames=1) {
+    deleteSprite();
+    _pixels = (uint16_t*)calloc((size_t)w * h, sizeof(uint16_t));
+    if (NULL != _pixels) {
+      _w = w;
+      _h = h;
+    }
+    return _pixels;
+  };
+  void deleteSprite() {
+    free(_pixels);
+    _pixels = NULL;
+    _w = 0;
+    _h = 0;
+  };
+  bool created() { return _pixels != NULL; };
+  void *getPointer() { return _pixels; };
+
+  void pushSprite(int32_t x, int32_t y) { _tft->pushImage(x, y, _w, _h, _pixels); };
+
+  virtual void fillRect(int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color) {
+    int32_t x1 = max(x, (int32_t)0), y1 = max(y, (int32_t)0);
+    int32_t x2 = min(x + w, (int32_t)_w), y2 = min(y + h, (int32_t)_h);
+    uint16_t swapped = (uint16_t)((color >> 8) | (color << 8));
+    for (int32_t row = y1; row < y2; row++) {
+      for (int32_t col = x1; col < x2; col++) {
+        _pixels[row * _w + col] = swapped;
+      }
+    }
+  };
+  virtual void drawFastHLine(int32_t x, int32_t y, int32_t w, uint32_t color) {
+    fillRect(x, y, w, 1, color);
+  };
+  virtual void drawFastVLine(int32_t x, int32_t y, int32_t h, uint32_t color) {
+    fillRect(x, y, 1, h, color);
+  };
+  virtual void readRect(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) {
+    for (int32_t row = 0; row < h; row++) {
+      for (int32_t col = 0; col < w; col++) {
+        data[row * w + col] = _pixels[(y + row) * _w + (x + col)];
+      }
+    }
+  };
+  virtual void pushImage(int32_t x, int32_t y, int32_t w, int32_t h, uint16_t *data) {
+    for (int32_t row = max(y, (int32_t)0); row < min(y + h, (int32_t)_h); row++) {
+      for (int32_t col = max(x, (int32_t)0); col < min(x + w, (int32_t)_w); col++) {
+        _pixels[row * _w + col] = data[(row - y) * w + (col - x)];
+      }
+    }
+  };
+
+private:
+  TFT_eSPI *_tft;
+  uint16_t *_pixels;
+};
+
+#endif // __UIW_BENCH_TFT_ESPI_H
@@ -0,0 +1,26 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include <time.h>
+
+#include "Arduino.h"
+
+static uint64_t nowMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+unsigned long micros() {
+  return (unsigned long)nowMicros();
+}
+
+unsigned long millis() {
+  return (unsigned long)(nowMicros() / 1000);
+}
+
+void delay(unsigned long ms) {
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000;
+  nanosleep(&ts, NULL);
+}
@@ -0,0 +1,84 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include <chrono>
+
+#include "thread_transport.h"
+
+ThreadTransport::ThreadTransport(int16_t w, int16_t h, uint32_t bitsPerSecond, bool async):
+    PixelTransport(), _w(w), _h(h), _bitsPerSecond(bitsPerSecond), _async(async),
+    _busy(false), _stop(false), _pixels(NULL) {
+  _frameBuffer = new uint16_t[(size_t)w * h]();
+  _worker = std::thread(&ThreadTransport::_run, this);
+}
+
+ThreadTransport::~ThreadTransport() {
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _stop = true;
+  }
+  _cond.notify_all();
+  _worker.join();
+  delete[] _frameBuffer;
+}
+
+void ThreadTransport::startPush(int16_t x, int16_t y, int16_t w, int16_t h,
+    const uint16_t *pixels) {
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _cond.wait(lock, [this]() { return !_busy; });
+    _area.x = x;
+    _area.y = y;
+    _area.w = w;
+    _area.h = h;
+    _pixels = pixels;
+    _busy = true;
+  }
+  _cond.notify_all();
+
+  if (!_async) {
+    waitIdle();
+  }
+}
+
+bool ThreadTransport::isBusy() {
+  std::lock_guard<std::mutex> lock(_mutex);
+  return _busy;
+}
+
+void ThreadTransport::waitIdle() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  _cond.wait(lock, [this]() { return !_busy; });
+}
+
+void ThreadTransport::_run() {
+  std::unique_lock<std::mutex> lock(_mutex);
+  while (true) {
+    _cond.wait(lock, [this]() { return _busy || _stop; });
+    if (_stop) {
+      return;
+    }
+
+    UIRect area = _area;
+    const uint16_t *pixels = _pixels;
+    lock.unlock();
+
+    // 16 bits per pixel on the wire. The thread sleeps out the rest of the transfer time rather
+    // than spinning, since a real DMA transfer leaves the CPU free.
+    std::chrono::steady_clock::time_point done = std::chrono::steady_clock::now()
+        + std::chrono::nanoseconds((uint64_t)area.area() * 16 * 1000000000 / _bitsPerSecond);
+
+    UIRect dest = area.intersection(UIRect { 0, 0, _w, _h });
+    for (int16_t row = dest.y; row < dest.y + dest.h; row++) {
+      for (int16_t col = dest.x; col < dest.x + dest.w; col++) {
+        uint16_t px = pixels[(row - area.y) * area.w + (col - area.x)];
+        _frameBuffer[row * _w + col] = (px >> 8) | (px << 8); // Undo the sprite's byte swap.
+      }
+    }
+
+    std::this_thread::sleep_until(done);
+
+    lock.lock();
+    _busy = false;
+    _cond.notify_all();
+  }
+}
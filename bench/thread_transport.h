@@ -0,0 +1,49 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_BENCH_THREAD_TRANSPORT_H
+#define __UIW_BENCH_THREAD_TRANSPORT_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "uiwidgets.h"
+
+/**
+ * A stand-in for a DMA-driven display transfer: a background thread copies each pushed rectangle
+ * into a frame buffer, taking as long as sending it over an SPI bus at 'bitsPerSecond' would.
+ *
+ * If 'async' is false, startPush() waits for each transfer to complete, as a synchronous
+ * (non-DMA) push would.
+ */
+class ThreadTransport : public PixelTransport {
+public:
+  ThreadTransport(int16_t w, int16_t h, uint32_t bitsPerSecond, bool async=true);
+  virtual ~ThreadTransport();
+
+  virtual void startPush(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels);
+  virtual bool isBusy();
+  virtual void waitIdle();
+
+  // The frame buffer that pushed pixels are copied into.
+  const uint16_t *getFrameBuffer() const { return _frameBuffer; };
+
+private:
+  void _run();
+
+  int16_t _w, _h;
+  uint16_t *_frameBuffer;
+  uint32_t _bitsPerSecond;
+  bool _async;
+
+  std::mutex _mutex;
+  std::condition_variable _cond;
+  bool _busy; // True from startPush() until the worker finishes the transfer.
+  bool _stop;
+  UIRect _area; // Area and pixels of the current transfer.
+  const uint16_t *_pixels;
+
+  std::thread _worker;
+};
+
+#endif // __UIW_BENCH_THREAD_TRANSPORT_H
@@ -2,7 +2,8 @@
 
 #include "uiwidgets.h"
 
-void UIButton::render(TFT_eSPI &lcd, uint32_t renderFlags) {
+void UIButton::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
   // We explicitly ignore (clobber, actually) border and background.
   _border_flags = BORDER_NONE;
 
@@ -23,11 +24,57 @@ void UIButton::render(TFT_eSPI &lcd, uint32_t renderFlags) {
   lcd.drawString(_btnLabel, childX + BORDER_ROUNDED_INNER_MARGIN, childY + BORDER_ROUNDED_INNER_MARGIN);
 }
 
-int16_t UIButton::getContentWidth(TFT_eSPI &lcd) const {
-  return lcd.textWidth(_btnLabel, _fontId) + 2 * BORDER_ROUNDED_INNER_MARGIN;
+int16_t UIButton::getContentWidth(DrawTarget &lcd) const {
+  if (_textWidth == SIZE_NOT_MEASURED) {
+    _textWidth = lcd.textWidth(_btnLabel, _fontId);
+  }
+
+  return _textWidth + 2 * BORDER_ROUNDED_INNER_MARGIN;
+}
+
+int16_t UIButton::getContentHeight(DrawTarget &lcd) const {
+  if (_textHeight == SIZE_NOT_MEASURED) {
+    _textHeight = lcd.fontHeight(_fontId);
+  }
+
+  return _textHeight + 2 * BORDER_ROUNDED_INNER_MARGIN;
 }
 
-int16_t UIButton::getContentHeight(TFT_eSPI &lcd) const {
-  return lcd.fontHeight(_fontId) + 2 * BORDER_ROUNDED_INNER_MARGIN;
+void UIButton::setFont(int fontId) {
+  if (fontId != _fontId) {
+    _fontId = fontId;
+    _remeasure(true);
+  }
 }
 
+// Measure the text again along each axis it has been measured on (see Label::_remeasure()), and
+// if either size changed, lay the widget tree out again.
+void UIButton::_remeasure(bool fontChanged) {
+  int16_t oldWidth = _textWidth;
+  int16_t oldHeight = fontChanged ? _textHeight : SIZE_NOT_MEASURED;
+  _textWidth = SIZE_NOT_MEASURED;
+  if (fontChanged) {
+    _textHeight = SIZE_NOT_MEASURED;
+  }
+
+  if (oldWidth == SIZE_NOT_MEASURED && oldHeight == SIZE_NOT_MEASURED) {
+    return;
+  } else if (NULL == _layoutTarget) {
+    invalidateLayout(); // Can't tell if the size changed.
+    return;
+  }
+
+  bool changed = false;
+  if (oldWidth != SIZE_NOT_MEASURED) {
+    _textWidth = _layoutTarget->textWidth(_btnLabel, _fontId);
+    changed = _textWidth != oldWidth;
+  }
+  if (oldHeight != SIZE_NOT_MEASURED) {
+    _textHeight = _layoutTarget->fontHeight(_fontId);
+    changed = changed || _textHeight != oldHeight;
+  }
+
+  if (changed) {
+    invalidateLayout();
+  }
+}
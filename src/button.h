@@ -6,18 +6,20 @@
 // A "clickable" / selectable button.
 class UIButton : public UIWidget {
 public:
-  UIButton(const char *str=NULL): UIWidget(), _fontId(0), _color(TFT_WHITE), _btnLabel(str) {};
+  UIButton(const char *str=NULL): UIWidget(), _fontId(0), _color(TFT_WHITE), _btnLabel(str),
+      _textWidth(SIZE_NOT_MEASURED), _textHeight(SIZE_NOT_MEASURED) {};
 
-  void setText(const char *str) { _btnLabel = str; };
+  void setText(const char *str) { _btnLabel = str; _remeasure(false); };
   const char *getText() const { return _btnLabel; };
 
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
+  virtual bool isOpaque(uint32_t renderFlags) const { return false; }; // Background is ignored.
 
   // TODO(aaron): Handle FreeFont fonts too.
-  void setFont(int fontId) { _fontId = fontId; };
+  void setFont(int fontId);
   void setColor(uint16_t color) { _color = color; };
   // TODO(aaron): Implement font size multiplier and set textsize.
 
@@ -26,6 +28,11 @@ protected:
   uint16_t _color;
   const char *_btnLabel;
 
+private:
+  void _remeasure(bool fontChanged);
+
+  mutable int16_t _textWidth; // Cached width of _btnLabel, or SIZE_NOT_MEASURED.
+  mutable int16_t _textHeight; // Cached font height, or SIZE_NOT_MEASURED.
 };
 
 #endif // _IUW_BUTTON_H
@@ -0,0 +1,391 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+// Character cell size for each built-in TFT_eSPI font id, approximating the real fonts' metrics.
+struct CanvasFontCell {
+  uint8_t w, h;
+};
+
+static const CanvasFontCell canvasFontCells[] = {
+  { 6, 8 },   // 0: GLCD
+  { 6, 8 },   // 1: GLCD
+  { 8, 16 },  // 2
+  { 6, 8 },   // 3: unused; treated as GLCD
+  { 14, 26 }, // 4
+  { 6, 8 },   // 5: unused; treated as GLCD
+  { 27, 48 }, // 6
+  { 32, 48 }, // 7: 7-segment
+  { 55, 75 }, // 8
+};
+
+static const CanvasFontCell &fontCell(uint8_t fontId) {
+  if (fontId >= sizeof(canvasFontCells) / sizeof(canvasFontCells[0])) {
+    fontId = 1;
+  }
+
+  return canvasFontCells[fontId];
+}
+
+CanvasDrawTarget::CanvasDrawTarget(int16_t w, int16_t h, uint16_t *pixels):
+    DrawTarget(), _pixels(pixels), _ownsPixels(false), _w(w), _h(h),
+    _offscreenPixels(NULL), _offscreenCapacity(0),
+    _fontId(1), _textFg(TFT_WHITE), _textBg(TRANSPARENT_COLOR) {
+
+  if (NULL == _pixels) {
+    _pixels = new uint16_t[(int32_t)w * h]();
+    _ownsPixels = true;
+  }
+
+  UIRect all = { 0, 0, w, h };
+  _setSurface(_pixels, all);
+}
+
+CanvasDrawTarget::~CanvasDrawTarget() {
+  releaseOffscreen();
+  if (_ownsPixels) {
+    delete [] _pixels;
+  }
+}
+
+uint16_t CanvasDrawTarget::getPixel(int16_t x, int16_t y) const {
+  if (x < 0 || y < 0 || x >= _w || y >= _h) {
+    return 0;
+  }
+
+  return _pixels[(int32_t)y * _w + x];
+}
+
+// Switch to drawing onto 'pixels', which holds the pixels of 'area'.
+void CanvasDrawTarget::_setSurface(uint16_t *pixels, const UIRect &area) {
+  _cur = pixels;
+  _curArea = area;
+  _updateVisible();
+}
+
+void CanvasDrawTarget::_updateVisible() {
+  _visible = _clipped ? _curArea.intersection(_clip) : _curArea;
+}
+
+void CanvasDrawTarget::setClipRect(const UIRect &clip) {
+  DrawTarget::setClipRect(clip);
+  _updateVisible();
+}
+
+void CanvasDrawTarget::clearClipRect() {
+  DrawTarget::clearClipRect();
+  _updateVisible();
+}
+
+// Draw a horizontal run of pixels, clipped to the visible part of the current surface. All fills
+// go through here.
+void CanvasDrawTarget::_hline(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  if (y < _visible.y || y >= _visible.y + _visible.h) {
+    return;
+  }
+
+  int16_t x0 = max(x, _visible.x);
+  int16_t x1 = min(x + w, _visible.x + _visible.w);
+  if (x0 >= x1) {
+    return;
+  }
+
+  uint16_t *p = _cur + (int32_t)(y - _curArea.y) * _curArea.w + (x0 - _curArea.x);
+  for (int16_t i = x0; i < x1; i++) {
+    *p++ = color;
+  }
+}
+
+void CanvasDrawTarget::_pixel(int16_t x, int16_t y, uint16_t color) {
+  _hline(x, y, 1, color);
+}
+
+// Bresenham line.
+void CanvasDrawTarget::_line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+  int16_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  int16_t dy = y1 > y0 ? y0 - y1 : y1 - y0; // Negative.
+  int16_t sx = x0 < x1 ? 1 : -1;
+  int16_t sy = y0 < y1 ? 1 : -1;
+  int16_t err = dx + dy;
+
+  while (true) {
+    _pixel(x0, y0, color);
+    if (x0 == x1 && y0 == y1) {
+      break;
+    }
+
+    int16_t e2 = 2 * err;
+    if (e2 >= dy) {
+      err += dy;
+      x0 += sx;
+    }
+    if (e2 <= dx) {
+      err += dx;
+      y0 += sy;
+    }
+  }
+}
+
+void CanvasDrawTarget::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  int16_t y0 = max(y, _visible.y);
+  int16_t y1 = min(y + h, _visible.y + _visible.h);
+  for (int16_t row = y0; row < y1; row++) {
+    _hline(x, row, w, color);
+  }
+}
+
+void CanvasDrawTarget::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (w <= 0 || h <= 0) {
+    return;
+  }
+
+  _hline(x, y, w, color);
+  _hline(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void CanvasDrawTarget::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  _hline(x, y, w, color);
+}
+
+void CanvasDrawTarget::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRect(x, y, 1, h, color);
+}
+
+// Draw the outline of one or more quarter-circles of radius r centered on (x0, y0).
+// 'corners' bits: 0x1 = top-left, 0x2 = top-right, 0x4 = bottom-right, 0x8 = bottom-left.
+void CanvasDrawTarget::_circleCorners(int16_t x0, int16_t y0, int16_t r, uint8_t corners,
+    uint16_t color) {
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (corners & 0x1) {
+      _pixel(x0 - y, y0 - x, color);
+      _pixel(x0 - x, y0 - y, color);
+    }
+    if (corners & 0x2) {
+      _pixel(x0 + x, y0 - y, color);
+      _pixel(x0 + y, y0 - x, color);
+    }
+    if (corners & 0x4) {
+      _pixel(x0 + x, y0 + y, color);
+      _pixel(x0 + y, y0 + x, color);
+    }
+    if (corners & 0x8) {
+      _pixel(x0 - y, y0 + x, color);
+      _pixel(x0 - x, y0 + y, color);
+    }
+  }
+}
+
+void CanvasDrawTarget::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  r = min(r, (int16_t)(min(w, h) / 2));
+  if (r <= 0) {
+    drawRect(x, y, w, h, color);
+    return;
+  }
+
+  _hline(x + r, y, w - 2 * r, color);
+  _hline(x + r, y + h - 1, w - 2 * r, color);
+  drawFastVLine(x, y + r, h - 2 * r, color);
+  drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+
+  _circleCorners(x + r, y + r, r, 0x1, color);
+  _circleCorners(x + w - r - 1, y + r, r, 0x2, color);
+  _circleCorners(x + w - r - 1, y + h - r - 1, r, 0x4, color);
+  _circleCorners(x + r, y + h - r - 1, r, 0x8, color);
+}
+
+void CanvasDrawTarget::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  fillRoundRectSpans(x, y, w, h, r, color);
+}
+
+void CanvasDrawTarget::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  _line(x0, y0, x1, y1, color);
+  _line(x1, y1, x2, y2, color);
+  _line(x2, y2, x0, y0, color);
+}
+
+// Scanline triangle fill.
+void CanvasDrawTarget::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  // Sort vertices by y so that y0 <= y1 <= y2.
+  int16_t t;
+  if (y0 > y1) { t = y0; y0 = y1; y1 = t; t = x0; x0 = x1; x1 = t; }
+  if (y1 > y2) { t = y2; y2 = y1; y1 = t; t = x2; x2 = x1; x1 = t; }
+  if (y0 > y1) { t = y0; y0 = y1; y1 = t; t = x0; x0 = x1; x1 = t; }
+
+  if (y0 == y2) {
+    // Degenerate; all on one line.
+    int16_t a = min(x0, min(x1, x2));
+    int16_t b = max(x0, max(x1, x2));
+    _hline(a, y0, b - a + 1, color);
+    return;
+  }
+
+  int32_t dx01 = x1 - x0, dy01 = y1 - y0;
+  int32_t dx02 = x2 - x0, dy02 = y2 - y0;
+  int32_t dx12 = x2 - x1, dy12 = y2 - y1;
+  int32_t sa = 0, sb = 0;
+
+  // Upper part: rows y0..y1 (including y1 only if the lower part is flat).
+  int16_t last = (y1 == y2) ? y1 : y1 - 1;
+  int16_t y;
+  for (y = y0; y <= last; y++) {
+    int16_t a = x0 + sa / dy01;
+    int16_t b = x0 + sb / dy02;
+    sa += dx01;
+    sb += dx02;
+    if (a > b) { t = a; a = b; b = t; }
+    _hline(a, y, b - a + 1, color);
+  }
+
+  // Lower part: rows y1..y2.
+  sa = dx12 * (y - y1);
+  sb = dx02 * (y - y0);
+  for (; y <= y2; y++) {
+    int16_t a = x1 + sa / dy12;
+    int16_t b = x0 + sb / dy02;
+    sa += dx12;
+    sb += dx02;
+    if (a > b) { t = a; a = b; b = t; }
+    _hline(a, y, b - a + 1, color);
+  }
+}
+
+void CanvasDrawTarget::pushImage(int16_t x, int16_t y, int16_t w, int16_t h,
+    const uint16_t *pixels) {
+  for (int16_t row = 0; row < h; row++) {
+    int16_t py = y + row;
+    if (py < _visible.y || py >= _visible.y + _visible.h) {
+      continue;
+    }
+
+    int16_t x0 = max(x, _visible.x);
+    int16_t x1 = min(x + w, _visible.x + _visible.w);
+    if (x0 < x1) {
+      memcpy(_cur + (int32_t)(py - _curArea.y) * _curArea.w + (x0 - _curArea.x),
+          pixels + (int32_t)row * w + (x0 - x), (x1 - x0) * sizeof(uint16_t));
+    }
+  }
+}
+
+bool CanvasDrawTarget::copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX,
+    int16_t dstY) {
+  UIRect src = { x, y, w, h };
+  UIRect dst = { dstX, dstY, w, h };
+  if (_cur != _pixels || !_visible.contains(src) || !_visible.contains(dst)) {
+    return false; // Drawing off-screen, or the block is not entirely within the clip rect.
+  }
+
+  // Copy the rows in an order that reads each one before it is overwritten.
+  for (int16_t i = 0; i < h; i++) {
+    int16_t row = dstY > y ? h - 1 - i : i;
+    memmove(_pixels + (int32_t)(dstY + row) * _w + dstX, _pixels + (int32_t)(y + row) * _w + x,
+        w * sizeof(uint16_t));
+  }
+
+  return true;
+}
+
+int16_t CanvasDrawTarget::drawString(const char *str, int16_t x, int16_t y) {
+  if (NULL == str) {
+    return 0;
+  }
+
+  const CanvasFontCell &cell = fontCell(_fontId);
+  int16_t cx = x;
+  for (const char *c = str; *c != '\0'; c++, cx += cell.w) {
+    if (_textBg != TRANSPARENT_COLOR) {
+      fillRect(cx, y, cell.w, cell.h, _textBg);
+    }
+
+    if (*c != ' ') {
+      // Solid block standing in for the glyph, leaving a 1px gap between characters and lines.
+      fillRect(cx, y, cell.w - 1, cell.h - 1, _textFg);
+    }
+  }
+
+  return cx - x;
+}
+
+int16_t CanvasDrawTarget::drawNumber(long val, int16_t x, int16_t y) {
+  char buf[NUMBER_BUF_LEN];
+  formatNumber(val, buf);
+  return drawString(buf, x, y);
+}
+
+int16_t CanvasDrawTarget::drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y) {
+  char buf[NUMBER_BUF_LEN];
+  formatFloat(val, decimalDigits, buf);
+  return drawString(buf, x, y);
+}
+
+int16_t CanvasDrawTarget::textWidth(const char *str, uint8_t fontId) {
+  if (NULL == str) {
+    return 0;
+  }
+
+  return strlen(str) * fontCell(fontId).w;
+}
+
+int16_t CanvasDrawTarget::fontHeight(uint8_t fontId) {
+  return fontCell(fontId).h;
+}
+
+bool CanvasDrawTarget::beginOffscreen(const UIRect &area) {
+  if (area.isEmpty()) {
+    return false;
+  }
+
+  if (area.area() > _offscreenCapacity) {
+    releaseOffscreen();
+    _offscreenPixels = new uint16_t[area.area()];
+    _offscreenCapacity = area.area();
+  }
+
+  _setSurface(_offscreenPixels, area);
+  return true;
+}
+
+void CanvasDrawTarget::endOffscreen() {
+  if (_cur != _offscreenPixels || NULL == _offscreenPixels) {
+    return; // Not drawing off-screen.
+  }
+
+  // Switch back to the main surface and copy the off-screen area onto it.
+  UIRect area = _curArea;
+  UIRect all = { 0, 0, _w, _h };
+  _setSurface(_pixels, all);
+
+  pushImage(area.x, area.y, area.w, area.h, _offscreenPixels);
+}
+
+void CanvasDrawTarget::finishOffscreen() {
+  UIRect all = { 0, 0, _w, _h };
+  _setSurface(_pixels, all);
+}
+
+void CanvasDrawTarget::releaseOffscreen() {
+  finishOffscreen();
+  delete [] _offscreenPixels;
+  _offscreenPixels = NULL;
+  _offscreenCapacity = 0;
+}
@@ -0,0 +1,93 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_CANVAS_H
+#define __UIW_CANVAS_H
+
+/**
+ * A DrawTarget that rasterizes into an in-memory buffer of RGB565 pixels (row-major, one
+ * uint16_t per pixel, in native byte order). This needs no display hardware, so it can run the
+ * library headless, e.g., to test or benchmark widget code on a host machine.
+ *
+ * Text is laid out with fixed-size character cells approximating the built-in TFT_eSPI fonts
+ * (font 1 is 6x8 pixels, font 2 is 8x16, font 4 is 14x26, etc.); each non-space character is drawn
+ * as a solid block within its cell rather than as a real glyph.
+ */
+class CanvasDrawTarget : public DrawTarget {
+public:
+  // Draw into a buffer of w*h pixels. If 'pixels' is NULL, the canvas allocates its own buffer.
+  CanvasDrawTarget(int16_t w, int16_t h, uint16_t *pixels=NULL);
+  virtual ~CanvasDrawTarget();
+
+  uint16_t *getPixels() { return _pixels; };
+  // Return the color of the specified pixel, or 0 if it is out of bounds.
+  uint16_t getPixel(int16_t x, int16_t y) const;
+
+  virtual int16_t width() { return _w; };
+  virtual int16_t height() { return _h; };
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+
+  virtual void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels);
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY);
+  virtual bool isCopyCheap() { return true; }; // copyRect() is a memmove() per row.
+
+  virtual void setTextFont(uint8_t fontId) { _fontId = fontId; };
+  virtual void setTextColor(uint16_t fgColor) { _textFg = fgColor; _textBg = TRANSPARENT_COLOR; };
+  virtual void setTextColor(uint16_t fgColor, uint16_t bgColor) {
+    _textFg = fgColor;
+    _textBg = bgColor;
+  };
+
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y);
+  virtual int16_t drawNumber(long val, int16_t x, int16_t y);
+  virtual int16_t drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y);
+
+  virtual int16_t textWidth(const char *str, uint8_t fontId);
+  virtual int16_t fontHeight(uint8_t fontId);
+
+  virtual bool beginOffscreen(const UIRect &area);
+  virtual void endOffscreen();
+  virtual void finishOffscreen();
+  virtual void releaseOffscreen();
+
+  virtual void setClipRect(const UIRect &clip);
+  virtual void clearClipRect();
+
+private:
+  void _hline(int16_t x, int16_t y, int16_t w, uint16_t color);
+  void _pixel(int16_t x, int16_t y, uint16_t color);
+  void _line(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color);
+  void _circleCorners(int16_t x0, int16_t y0, int16_t r, uint8_t corners, uint16_t color);
+  void _setSurface(uint16_t *pixels, const UIRect &area);
+  void _updateVisible();
+
+  uint16_t *_pixels;
+  bool _ownsPixels;
+  int16_t _w, _h;
+
+  // The surface currently drawn onto: either _pixels (covering the whole canvas) or
+  // _offscreenPixels (covering the off-screen area).
+  uint16_t *_cur;
+  UIRect _curArea;
+  UIRect _visible; // _curArea, intersected with the clip rect if set. Drawing is clipped to this.
+
+  uint16_t *_offscreenPixels;
+  int32_t _offscreenCapacity; // Number of pixels allocated in _offscreenPixels.
+
+  uint8_t _fontId;
+  uint16_t _textFg;
+  uint16_t _textBg;
+};
+
+#endif // __UIW_CANVAS_H
@@ -0,0 +1,122 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+// Fill the left (sides & 0x2) and/or right (sides & 0x1) halves of a circle of radius r centered
+// on (x0, y0), with the vertical spans stretched by 'delta' pixels.
+static void fillCircleSides(DrawTarget &target, int16_t x0, int16_t y0, int16_t r, uint8_t sides,
+    int16_t delta, uint16_t color) {
+  int16_t f = 1 - r;
+  int16_t ddF_x = 1;
+  int16_t ddF_y = -2 * r;
+  int16_t x = 0;
+  int16_t y = r;
+
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddF_y += 2;
+      f += ddF_y;
+    }
+    x++;
+    ddF_x += 2;
+    f += ddF_x;
+
+    if (sides & 0x1) {
+      target.fillRect(x0 + x, y0 - y, 1, 2 * y + 1 + delta, color);
+      target.fillRect(x0 + y, y0 - x, 1, 2 * x + 1 + delta, color);
+    }
+    if (sides & 0x2) {
+      target.fillRect(x0 - x, y0 - y, 1, 2 * y + 1 + delta, color);
+      target.fillRect(x0 - y, y0 - x, 1, 2 * x + 1 + delta, color);
+    }
+  }
+}
+
+void DrawTarget::fillRoundRectSpans(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  r = min(r, (int16_t)(min(w, h) / 2));
+  if (r <= 0) {
+    fillRect(x, y, w, h, color);
+    return;
+  }
+
+  fillRect(x + r, y, w - 2 * r, h, color);
+  fillCircleSides(*this, x + w - r - 1, y + r, r, 0x1, h - 2 * r - 1, color);
+  fillCircleSides(*this, x + r, y + r, r, 0x2, h - 2 * r - 1, color);
+}
+
+/**
+ * Write the decimal digits of 'val' into 'buf' (which must hold NUMBER_BUF_LEN chars), and return
+ * a pointer to the terminating NUL.
+ */
+static char *formatDigits(unsigned long val, char *buf) {
+  char digits[NUMBER_BUF_LEN];
+  uint8_t n = 0;
+  do {
+    digits[n++] = '0' + (val % 10);
+    val /= 10;
+  } while (val > 0);
+
+  while (n > 0) {
+    *buf++ = digits[--n];
+  }
+  *buf = '\0';
+  return buf;
+}
+
+void DrawTarget::formatNumber(long val, char *buf) {
+  unsigned long mag = (unsigned long)val;
+  if (val < 0) {
+    *buf++ = '-';
+    mag = 0 - mag;
+  }
+  formatDigits(mag, buf);
+}
+
+void DrawTarget::formatFloat(float val, uint8_t decimalDigits, char *buf) {
+  if (decimalDigits > 7) {
+    decimalDigits = 7; // Same limit as TFT_eSPI::drawFloat().
+  }
+
+  float rounding = 0.5;
+  for (uint8_t i = 0; i < decimalDigits; i++) {
+    rounding /= 10.0;
+  }
+
+  // No sign for values that round to zero.
+  char *p = buf;
+  if (val < -rounding) {
+    *p++ = '-';
+    val = -val;
+  }
+  val += rounding;
+
+  if (val >= 2147483647) {
+    strcpy(buf, "..."); // Too large to print; drawFloat() drops the sign too.
+    return;
+  }
+
+  // The integer part, then a decimal point and at least one decimal digit. Like drawFloat(), stop
+  // short of 'decimalDigits' rather than print more than 9 digits in all, counting one extra
+  // whether or not there is a sign.
+  uint32_t intPart = (uint32_t)val;
+  char *intStart = p;
+  p = formatDigits(intPart, p);
+  uint8_t numDigits = 1 + (p - intStart);
+  *p++ = '.';
+  char *fracStart = p;
+
+  float frac = val - intPart;
+  for (uint8_t i = 0; i < decimalDigits && numDigits < 9; i++, numDigits++) {
+    frac *= 10.0;
+    uint8_t digit = (uint8_t)frac;
+    *p++ = '0' + digit;
+    frac -= digit;
+  }
+
+  if (p == fracStart) {
+    *p++ = '0';
+  }
+  *p = '\0';
+}
@@ -0,0 +1,140 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_DRAW_TARGET_H
+#define __UIW_DRAW_TARGET_H
+
+#include <stdint.h>
+
+#include "rect.h"
+
+// Enough room for any number formatted by DrawTarget::formatNumber() or formatFloat().
+constexpr uint8_t NUMBER_BUF_LEN = 24;
+
+/**
+ * A surface that widgets draw themselves onto. This covers exactly the drawing primitives and
+ * text metrics used by the widgets in this library.
+ *
+ * TftDrawTarget draws to a TFT_eSPI display; CanvasDrawTarget draws into an RGB565 buffer in
+ * memory (e.g., to run the library headless on a host machine).
+ *
+ * All coordinates are absolute screen coordinates. Drawing outside the surface (or outside the
+ * clip rect, if one is set) is clipped.
+ */
+class DrawTarget {
+public:
+  DrawTarget(): _clipped(false) {
+    _clip.x = 0;
+    _clip.y = 0;
+    _clip.w = 0;
+    _clip.h = 0;
+  };
+  virtual ~DrawTarget() {};
+
+  virtual int16_t width() = 0;
+  virtual int16_t height() = 0;
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) = 0;
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) = 0;
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) = 0;
+  virtual void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color) = 0;
+  virtual void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color) = 0;
+  virtual void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color) = 0;
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color) = 0;
+
+  // Copy a block of RGB565 pixels (w * h, row-major) onto the surface.
+  virtual void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) = 0;
+
+  /**
+   * Move the w * h block of pixels already on the surface at (x, y) to (dstX, dstY), e.g. to
+   * scroll content without drawing it again. Both the source and destination must lie within the
+   * clip rect, if one is set. Returns false, drawing nothing, if the target cannot read back its
+   * pixels, or is drawing off-screen (where the buffer does not hold what is on the surface).
+   */
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY) {
+    return false;
+  };
+  /**
+   * Return true if copyRect() costs less than drawing the same area again usually does, so that
+   * moving pixels is worth it. Widgets that can do either (e.g., a VScroll redrawn with
+   * RF_VSCROLL_SHIFT) redraw when this returns false.
+   */
+  virtual bool isCopyCheap() { return false; };
+
+  // Text state applies to subsequent drawString() / drawNumber() / drawFloat() calls.
+  virtual void setTextFont(uint8_t fontId) = 0;
+  virtual void setTextColor(uint16_t fgColor) = 0; // Text drawn with transparent background.
+  virtual void setTextColor(uint16_t fgColor, uint16_t bgColor) = 0;
+
+  // Each returns the width in pixels of the text drawn.
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y) = 0;
+  virtual int16_t drawNumber(long val, int16_t x, int16_t y) = 0;
+  virtual int16_t drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y) = 0;
+
+  // Format a number into 'buf' (which must hold NUMBER_BUF_LEN chars) exactly as
+  // TFT_eSPI::drawNumber() / drawFloat() print it.
+  static void formatNumber(long val, char *buf);
+  static void formatFloat(float val, uint8_t decimalDigits, char *buf);
+
+  virtual int16_t textWidth(const char *str, uint8_t fontId) = 0;
+  virtual int16_t fontHeight(uint8_t fontId) = 0;
+
+  /**
+   * Off-screen drawing, for targets that support it. After beginOffscreen(area) returns true,
+   * drawing is redirected into a buffer covering 'area' (and clipped to it) until endOffscreen()
+   * copies that buffer onto the surface in one operation. The buffer is kept for later
+   * beginOffscreen() calls, and only reallocated for an area that does not fit in it.
+   * finishOffscreen() waits for any copy still in progress at the end of a redraw;
+   * releaseOffscreen() also frees the buffer.
+   *
+   * Returns false if off-screen drawing is unsupported or the buffer cannot be allocated, in
+   * which case drawing continues directly on the surface.
+   */
+  virtual bool beginOffscreen(const UIRect &area) { return false; };
+  virtual void endOffscreen() { };
+  virtual void finishOffscreen() { };
+  virtual void releaseOffscreen() { };
+
+  /**
+   * Restrict drawing to 'clip' until clearClipRect() is called. Fills, lines, and images are
+   * clipped exactly. Text, triangles, and rounded-rect outlines are skipped if they lie outside
+   * the clip rect, but may be drawn whole if they cross its edge; since widgets do not overlap,
+   * that only repaints pixels of the same widget with the same content.
+   *
+   * Containers use intersectsClip() to skip children that lie entirely outside the clip rect.
+   */
+  virtual void setClipRect(const UIRect &clip) { _clip = clip; _clipped = true; };
+  virtual void clearClipRect() { _clipped = false; };
+  bool hasClipRect() const { return _clipped; };
+  const UIRect &getClipRect() const { return _clip; };
+  // Return true if anything drawn within 'area' could be visible through the clip rect.
+  bool intersectsClip(const UIRect &area) const { return !_clipped || _clip.intersects(area); };
+
+protected:
+  // Shrink the rect (x, y, w, h) to the part of it within the clip rect. Returns false if none
+  // of it is.
+  bool clipToRect(int16_t &x, int16_t &y, int16_t &w, int16_t &h) const {
+    if (_clipped) {
+      UIRect r = { x, y, w, h };
+      r = r.intersection(_clip);
+      x = r.x;
+      y = r.y;
+      w = r.w;
+      h = r.h;
+    }
+    return w > 0 && h > 0;
+  };
+
+  // Fill a rounded rect as a series of fillRect() calls (matching TFT_eSPI's rasterization), so
+  // that it is clipped exactly wherever fillRect() is.
+  void fillRoundRectSpans(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r, uint16_t color);
+
+  UIRect _clip;
+  bool _clipped;
+};
+
+#endif // __UIW_DRAW_TARGET_H
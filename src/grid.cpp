@@ -0,0 +1,403 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+Grid::Grid(uint16_t numRows, uint16_t numCols): UIWidget(), _numRows(0), _numCols(0),
+    _maxRows(0), _maxCols(0), _stride(0), _cells(NULL), _tracks(NULL) {
+  setDimensions(numRows, numCols);
+}
+
+Grid::Grid(uint16_t numRows, uint16_t numCols, UIWidget **cells, int16_t *tracks): UIWidget(),
+    _numRows(numRows), _numCols(numCols), _maxRows(numRows), _maxCols(numCols), _stride(numCols),
+    _cells(cells), _tracks(tracks) {
+  _carveTracks(numRows, numCols);
+}
+
+Grid::~Grid() {
+  if (0 == _maxRows) {
+    delete [] _tracks;
+    delete [] _cells;
+  }
+}
+
+// Allocate zeroed cell and track arrays for a grid of the given size.
+void Grid::_allocate(uint16_t numRows, uint16_t numCols) {
+  _numRows = numRows;
+  _numCols = numCols;
+  _stride = numCols;
+  _cells = new UIWidget*[(uint32_t)numRows * numCols]();
+  _tracks = new int16_t[2 * ((uint32_t)numRows + numCols) + 2]();
+  _carveTracks(numRows, numCols);
+}
+
+// Point the row and column sizes and positions into _tracks, with room for the given dimensions.
+void Grid::_carveTracks(uint16_t maxRows, uint16_t maxCols) {
+  _rowSizes = _tracks;
+  _colSizes = _rowSizes + maxRows;
+  _rowPos = _colSizes + maxCols;
+  _colPos = _rowPos + maxRows + 1;
+}
+
+/**
+ * Update the number of rows and columns.
+ *
+ * Cells in rows and columns that exist in both the old and new grids are preserved, along with the
+ * sizes of those rows and columns. You must free any UIWidgets that no longer have a home before
+ * calling this method. New rows and columns have a size of 0; you must set their sizes.
+ */
+void Grid::setDimensions(uint16_t numRows, uint16_t numCols) {
+  if (_maxRows > 0) {
+    numRows = min(max(numRows, (uint16_t)1), _maxRows);
+    numCols = min(max(numCols, (uint16_t)1), _maxCols);
+    // Clear any cells and sizes dropped, so they start out empty if they're added back.
+    for (uint16_t r = 0; r < _numRows; r++) {
+      for (uint16_t c = (r < numRows ? numCols : 0); c < _numCols; c++) {
+        _cell(r, c) = NULL;
+      }
+    }
+
+    for (uint16_t r = numRows; r < _numRows; r++) {
+      _rowSizes[r] = 0;
+    }
+
+    for (uint16_t c = numCols; c < _numCols; c++) {
+      _colSizes[c] = 0;
+    }
+
+    _numRows = numRows;
+    _numCols = numCols;
+    invalidateLayout();
+    return;
+  }
+
+  uint16_t oldNumRows = _numRows;
+  uint16_t oldNumCols = _numCols;
+  UIWidget **oldCells = _cells;
+  int16_t *oldTracks = _tracks;
+  const int16_t *oldRowSizes = _rowSizes;
+  const int16_t *oldColSizes = _colSizes;
+
+  _allocate(max(numRows, (uint16_t)1), max(numCols, (uint16_t)1));
+
+  if (oldCells != NULL) {
+    // Transfer over the cells and sizes that carry into the newly sized grid.
+    uint16_t keepRows = min(oldNumRows, _numRows);
+    uint16_t keepCols = min(oldNumCols, _numCols);
+    for (uint16_t r = 0; r < keepRows; r++) {
+      _rowSizes[r] = oldRowSizes[r];
+      for (uint16_t c = 0; c < keepCols; c++) {
+        _cell(r, c) = oldCells[(uint32_t)r * oldNumCols + c];
+      }
+    }
+
+    for (uint16_t c = 0; c < keepCols; c++) {
+      _colSizes[c] = oldColSizes[c];
+    }
+
+    delete [] oldCells;
+    delete [] oldTracks;
+  }
+
+  invalidateLayout();
+}
+
+void Grid::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
+  drawBackground(lcd, renderFlags);
+  drawBorder(lcd, renderFlags);
+
+  if (isFocused(renderFlags)) {
+    renderFlags |= RF_FOCUSED; // propagate our focused nature to any child element(s).
+  }
+
+  for (uint16_t r = 0; r < _numRows; r++) {
+    UIRect rowBand = { _x, _rowPos[r], _w, (int16_t)(_rowPos[r + 1] - _rowPos[r]) };
+    if (!lcd.intersectsClip(rowBand)) {
+      continue; // Skip whole rows outside the clip rect.
+    }
+
+    for (uint16_t c = 0; c < _numCols; c++) {
+      UIWidget *widget = _cell(r, c);
+      if (widget != NULL && lcd.intersectsClip(widget->getRect())) {
+        widget->render(lcd, renderFlags);
+      }
+    }
+  }
+}
+
+void Grid::cascadeBoundingBox() {
+  UIW_STATS_SCOPE(_stats, STATS_LAYOUT);
+  // Get the inner bounding box.
+  int16_t childX, childY, childW, childH;
+  getChildAreaBoundingBox(childX, childY, childW, childH);
+
+  _layoutTracks(true, childY, childH);
+  _layoutTracks(false, childX, childW);
+
+  for (uint16_t r = 0; r < _numRows; r++) {
+    int16_t rowH = _rowPos[r + 1] - _rowPos[r];
+    for (uint16_t c = 0; c < _numCols; c++) {
+      UIWidget *widget = _cell(r, c);
+      if (widget != NULL) {
+        setChildBoundingBox(widget, _colPos[c], _rowPos[r], _colPos[c + 1] - _colPos[c], rowH);
+      }
+    }
+  }
+}
+
+/**
+ * Compute the start positions of the rows (or columns), which share 'available' pixels beginning
+ * at 'start'. As with Rows and Cols, EQUAL tracks share whatever space the fixed and FLEX tracks
+ * leave unclaimed.
+ */
+void Grid::_layoutTracks(bool rows, int16_t start, int16_t available) {
+  const uint16_t numTracks = rows ? _numRows : _numCols;
+  int16_t *pos = rows ? _rowPos : _colPos;
+
+  // Use pos[] to hold each track's claimed size until its position is known.
+  int16_t claimedSize = 0;
+  int16_t tracksWithClaimedSize = 0;
+  for (uint16_t i = 0; i < numTracks; i++) {
+    int16_t size = _claimedTrackSize(rows, i);
+    pos[i] = size;
+    if (size >= 0) {
+      claimedSize += size;
+      tracksWithClaimedSize++;
+    }
+  }
+
+  int16_t equalAvailableSize = max(0, available - claimedSize);
+  int16_t equalCount = numTracks - tracksWithClaimedSize;
+  const int16_t equalSize = equalAvailableSize / max(equalCount, 1);
+
+  for (uint16_t i = 0; i < numTracks; i++) {
+    int16_t size = pos[i];
+    if (size == EQUAL) {
+      size = equalSize;
+    } else {
+      size = min(size, available);
+    }
+
+    pos[i] = start;
+    start += size;
+  }
+
+  pos[numTracks] = start;
+}
+
+/**
+ * Return the size claimed by a row (or column): its fixed size, or for a FLEX track, the size of
+ * the largest widget in it. Returns EQUAL for tracks that share the unclaimed space.
+ */
+int16_t Grid::_claimedTrackSize(bool rows, uint16_t track) const {
+  int16_t size = rows ? _rowSizes[track] : _colSizes[track];
+  if (size != FLEX) {
+    return size;
+  } else if (NULL == _layoutTarget) {
+    return EQUAL; // No way to measure content outside of a Screen.
+  }
+
+  return _flexTrackSize(rows, track, *_layoutTarget);
+}
+
+// Return the content height of the tallest widget in a row, or width of the widest in a column.
+int16_t Grid::_flexTrackSize(bool rows, uint16_t track, DrawTarget &lcd) const {
+  int16_t size = 0;
+  uint16_t numCells = rows ? _numCols : _numRows;
+  for (uint16_t i = 0; i < numCells; i++) {
+    const UIWidget *widget = rows ? _cell(track, i) : _cell(i, track);
+    if (widget != NULL) {
+      size = max(size, rows ? widget->getContentHeight(lcd) : widget->getContentWidth(lcd));
+    }
+  }
+
+  return size;
+}
+
+/**
+ * Return the total height of the rows (or width of the columns), with FLEX tracks taking the size
+ * of their largest widget. If any track is EQUAL, return EQUAL; the grid will expand to its entire
+ * allocated area.
+ */
+int16_t Grid::_sumTrackSizes(bool rows, DrawTarget &lcd) const {
+  const uint16_t numTracks = rows ? _numRows : _numCols;
+  const int16_t *sizes = rows ? _rowSizes : _colSizes;
+
+  int16_t total = 0;
+  for (uint16_t i = 0; i < numTracks; i++) {
+    if (sizes[i] == EQUAL) {
+      return EQUAL;
+    } else if (sizes[i] == FLEX) {
+      total += _flexTrackSize(rows, i, lcd);
+    } else {
+      total += sizes[i];
+    }
+  }
+
+  return total;
+}
+
+int16_t Grid::getContentWidth(DrawTarget &lcd) const {
+  int16_t w = _sumTrackSizes(false, lcd);
+  return w == EQUAL ? _w : addBorderWidth(w);
+}
+
+int16_t Grid::getContentHeight(DrawTarget &lcd) const {
+  int16_t h = _sumTrackSizes(true, lcd);
+  return h == EQUAL ? _h : addBorderHeight(h);
+}
+
+/**
+ * Sets the widget in the specified cell. If this clobbers an existing UIWidget,
+ * you must free it first.
+ */
+void Grid::setCell(uint16_t row, uint16_t col, UIWidget *widget) {
+  if (row >= _numRows || col >= _numCols) {
+    return; // Invalid.
+  }
+
+  _cell(row, col) = widget;
+  invalidateLayout();
+}
+
+UIWidget *Grid::getCell(uint16_t row, uint16_t col) const {
+  if (row >= _numRows || col >= _numCols) {
+    return NULL; // Invalid.
+  }
+
+  return _cell(row, col);
+}
+
+void Grid::setRowHeight(uint16_t row, int16_t height) {
+  if (row >= _numRows) {
+    return; // Invalid.
+  }
+
+  _rowSizes[row] = height;
+  invalidateLayout();
+}
+
+int16_t Grid::getRowHeight(uint16_t row) const {
+  if (row >= _numRows) {
+    return ERROR_INVALID_ELEMENT; // Invalid.
+  }
+
+  return _rowSizes[row];
+}
+
+void Grid::setFixedHeight(int16_t height) {
+  for (uint16_t r = 0; r < _numRows; r++) {
+    _rowSizes[r] = height;
+  }
+
+  invalidateLayout();
+}
+
+void Grid::setColumnWidth(uint16_t col, int16_t width) {
+  if (col >= _numCols) {
+    return; // Invalid.
+  }
+
+  _colSizes[col] = width;
+  invalidateLayout();
+}
+
+int16_t Grid::getColumnWidth(uint16_t col) const {
+  if (col >= _numCols) {
+    return ERROR_INVALID_ELEMENT; // Invalid.
+  }
+
+  return _colSizes[col];
+}
+
+void Grid::setFixedWidth(int16_t width) {
+  for (uint16_t c = 0; c < _numCols; c++) {
+    _colSizes[c] = width;
+  }
+
+  invalidateLayout();
+}
+
+/**
+ * Return the index of the row (or column) whose span in 'pos' (numTracks + 1 start positions, as
+ * computed by _layoutTracks()) includes coordinate 'p', or -1 if none does.
+ */
+static int32_t findTrack(const int16_t *pos, uint16_t numTracks, int16_t p) {
+  if (p < pos[0] || p >= pos[numTracks]) {
+    return -1;
+  }
+
+  // Binary search for the last track starting at or before p; pos[lo] <= p < pos[hi].
+  uint16_t lo = 0;
+  uint16_t hi = numTracks;
+  while (hi - lo > 1) {
+    uint16_t mid = lo + (hi - lo) / 2;
+    if (pos[mid] <= p) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return lo;
+}
+
+/**
+ * Return the widget in the cell through which 'widget' is drawn, or NULL. Widgets are fully
+ * nested within their containers, so the cell is the one containing the widget's top-left corner.
+ */
+UIWidget *Grid::_cellContaining(const UIWidget *widget) const {
+  if (NULL == widget) {
+    return NULL;
+  }
+
+  int32_t row = findTrack(_rowPos, _numRows, widget->getY());
+  int32_t col = findTrack(_colPos, _numCols, widget->getX());
+  if (row < 0 || col < 0) {
+    return NULL;
+  }
+
+  UIWidget *cell = _cell(row, col);
+  if (cell != NULL && cell->containsWidget(const_cast<UIWidget*>(widget))) {
+    return cell;
+  }
+
+  return NULL;
+}
+
+bool Grid::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
+  if (NULL == widget) {
+    return false;
+  } else if (this == widget) {
+    render(lcd, renderFlags);
+    return true;
+  }
+
+  UIWidget *cell = _cellContaining(widget);
+  if (cell != NULL) {
+    drawBackgroundUnderWidget(widget, lcd, renderFlags);
+    return cell->redrawChildWidget(widget, lcd, renderFlags);
+  }
+
+  return false;
+}
+
+UIWidget *Grid::getChildContaining(UIWidget *widget) const {
+  return _cellContaining(widget);
+}
+
+UIWidget *Grid::getChildAt(int16_t x, int16_t y) const {
+  int32_t row = findTrack(_rowPos, _numRows, y);
+  int32_t col = findTrack(_colPos, _numCols, x);
+  if (row < 0 || col < 0) {
+    return NULL;
+  }
+
+  UIWidget *cell = _cell(row, col);
+  if (cell != NULL && cell->containsPoint(x, y)) {
+    return cell;
+  }
+
+  return NULL;
+}
@@ -0,0 +1,91 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_GRID_H
+#define __UIW_GRID_H
+
+/**
+ * A table of widgets arranged in rows and columns. Each row has its own height and each column
+ * its own width (in pixels, or EQUAL or FLEX, as with Rows and Cols), and each cell holds at most
+ * one widget, which fills the cell.
+ *
+ * This is cheaper than nesting Cols within Rows: all cells live in one flat array, the whole grid
+ * is laid out in a single pass, and the cell containing a widget is found from its position
+ * rather than by searching each row in turn.
+ *
+ * A Grid allocates its cells on the heap, unless it is created by a WidgetArena; then they are
+ * allocated in the arena, and the grid cannot grow beyond the dimensions it was created with.
+ */
+class Grid: public UIWidget {
+public:
+  Grid(uint16_t numRows, uint16_t numCols);
+  ~Grid();
+
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
+  virtual void cascadeBoundingBox();
+
+  // Update the number of rows and columns. Cells (and row and column sizes) in the top-left corner
+  // carry over; you must free any UIWidgets that no longer have a home before calling this. A grid
+  // created by a WidgetArena is limited to the dimensions it was created with.
+  void setDimensions(uint16_t numRows, uint16_t numCols);
+  uint16_t getNumRows() const { return _numRows; };
+  uint16_t getNumCols() const { return _numCols; };
+
+  void setCell(uint16_t row, uint16_t col, UIWidget *widget);
+  UIWidget *getCell(uint16_t row, uint16_t col) const;
+
+  // Row height in pixels, or EQUAL to evenly distribute rows, or FLEX to fit the tallest widget
+  // in the row.
+  void setRowHeight(uint16_t row, int16_t height);
+  int16_t getRowHeight(uint16_t row) const;
+  void setFixedHeight(int16_t height); // a height applied to each row.
+  // Column width in pixels, or EQUAL to evenly distribute columns, or FLEX to fit the widest
+  // widget in the column.
+  void setColumnWidth(uint16_t col, int16_t width);
+  int16_t getColumnWidth(uint16_t col) const;
+  void setFixedWidth(int16_t width); // a width applied to each column.
+
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
+
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+  virtual UIWidget *getChildContaining(UIWidget *widget) const;
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const;
+
+protected:
+  friend class WidgetArena;
+  // Use caller-provided arrays, which must be zeroed, instead of allocating them: 'cells' of
+  // numRows * numCols entries, and 'tracks' of 2 * (numRows + numCols) + 2.
+  Grid(uint16_t numRows, uint16_t numCols, UIWidget **cells, int16_t *tracks);
+
+private:
+  UIWidget *&_cell(uint16_t row, uint16_t col) const {
+    return _cells[(uint32_t)row * _stride + col];
+  };
+
+  void _allocate(uint16_t numRows, uint16_t numCols);
+  void _carveTracks(uint16_t maxRows, uint16_t maxCols);
+  void _layoutTracks(bool rows, int16_t start, int16_t available);
+  int16_t _claimedTrackSize(bool rows, uint16_t track) const;
+  int16_t _flexTrackSize(bool rows, uint16_t track, DrawTarget &lcd) const;
+  int16_t _sumTrackSizes(bool rows, DrawTarget &lcd) const;
+  UIWidget *_cellContaining(const UIWidget *widget) const;
+
+  uint16_t _numRows;
+  uint16_t _numCols;
+  // Dimensions of caller-provided arrays, or 0 if they're allocated by the Grid.
+  uint16_t _maxRows;
+  uint16_t _maxCols;
+  uint16_t _stride; // Cells per row of _cells: _numCols, or _maxCols if caller-provided.
+  UIWidget **_cells; // _numRows rows of _stride cells, in row-major order.
+
+  // Row heights and column widths as configured, and the start of each row and column (plus the
+  // end of the last one) as of the last layout; all carved out of the single array _tracks, with
+  // room for _maxRows and _maxCols if caller-provided.
+  int16_t *_tracks;
+  int16_t *_rowSizes;
+  int16_t *_colSizes;
+  int16_t *_rowPos; // _numRows + 1 entries.
+  int16_t *_colPos; // _numCols + 1 entries.
+};
+
+#endif // __UIW_GRID_H
@@ -1,9 +1,9 @@
 // (c) Copyright 2022 Aaron Kimball
 
 #include "uiwidgets.h"
-#include <math.h>
 
-void Label::render(TFT_eSPI &lcd, uint32_t renderFlags) {
+void Label::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
   drawBackground(lcd, renderFlags);
   drawBorder(lcd, renderFlags);
 
@@ -22,48 +22,100 @@ void Label::render(TFT_eSPI &lcd, uint32_t renderFlags) {
   renderText(lcd);
 }
 
-void StrLabel::renderText(TFT_eSPI &lcd) {
+void Label::setFont(int fontId) {
+  if (fontId != _fontId) {
+    _fontId = fontId;
+    _remeasure(true);
+  }
+}
+
+void Label::textChanged() {
+  _remeasure(false);
+}
+
+/**
+ * Measure the text again along each axis it has been measured on, and if either size changed, lay
+ * the widget tree out again. Only containers sizing FLEX elements (or their own content) measure
+ * a label, so an unmeasured axis or an unchanged size means no layout depended on the old text.
+ * The text height only changes with the font.
+ */
+void Label::_remeasure(bool fontChanged) {
+  int16_t oldWidth = _textWidth;
+  int16_t oldHeight = fontChanged ? _textHeight : SIZE_NOT_MEASURED;
+  _textWidth = SIZE_NOT_MEASURED;
+  if (fontChanged) {
+    _textHeight = SIZE_NOT_MEASURED;
+  }
+
+  if (oldWidth == SIZE_NOT_MEASURED && oldHeight == SIZE_NOT_MEASURED) {
+    return;
+  } else if (NULL == _layoutTarget) {
+    invalidateLayout(); // Can't tell if the size changed.
+    return;
+  }
+
+  bool changed = false;
+  if (oldWidth != SIZE_NOT_MEASURED) {
+    _textWidth = measureTextWidth(*_layoutTarget);
+    changed = _textWidth != oldWidth;
+  }
+  if (oldHeight != SIZE_NOT_MEASURED) {
+    _textHeight = _layoutTarget->fontHeight(_fontId);
+    changed = changed || _textHeight != oldHeight;
+  }
+
+  if (changed) {
+    invalidateLayout();
+  }
+}
+
+int16_t Label::getContentWidth(DrawTarget &lcd) const {
+  if (_textWidth == SIZE_NOT_MEASURED) {
+    _textWidth = measureTextWidth(lcd);
+  }
+
+  return addBorderWidth(_textWidth);
+}
+
+int16_t Label::getContentHeight(DrawTarget &lcd) const {
+  if (_textHeight == SIZE_NOT_MEASURED) {
+    _textHeight = lcd.fontHeight(_fontId);
+  }
+
+  return addBorderHeight(_textHeight);
+}
+
+void StrLabel::renderText(DrawTarget &lcd) {
   int16_t childX, childY, childW, childH;
   getChildAreaBoundingBox(childX, childY, childW, childH);
   lcd.drawString(_str, childX, childY);
 }
 
-int16_t StrLabel::getContentWidth(TFT_eSPI &lcd) const {
-  return addBorderWidth(lcd.textWidth(_str, _fontId));
-}
-
-int16_t StrLabel::getContentHeight(TFT_eSPI &lcd) const {
-  return addBorderHeight(lcd.fontHeight(_fontId));
+int16_t StrLabel::measureTextWidth(DrawTarget &lcd) const {
+  return lcd.textWidth(_str, _fontId);
 }
 
-void IntLabel::renderText(TFT_eSPI &lcd) {
+void IntLabel::renderText(DrawTarget &lcd) {
   int16_t childX, childY, childW, childH;
   getChildAreaBoundingBox(childX, childY, childW, childH);
   lcd.drawNumber(_val, childX, childY);
 }
 
-int16_t IntLabel::getContentWidth(TFT_eSPI &lcd) const {
-  if (_val == 0) {
-    return addBorderWidth(lcd.textWidth("0", _fontId));
-  } else {
-    // There is no textWidth() for numbers, but we know the number of digits is
-    // proportional to the base10 log of the number.
-    int neg = 0;
-    long num = _val;
-    if (_val < 0) {
-      neg = 1; // Add a character for the leading '-' sign.
-      num = -_val;
-    }
-    return addBorderWidth((neg + ceil(log10(num))) * lcd.textWidth("0", _fontId));
+void IntLabel::setValue(long val) {
+  if (val != _val) {
+    _val = val;
+    textChanged();
   }
-
 }
 
-int16_t IntLabel::getContentHeight(TFT_eSPI &lcd) const {
-  return addBorderHeight(lcd.fontHeight(_fontId));
+int16_t IntLabel::measureTextWidth(DrawTarget &lcd) const {
+  // There is no textWidth() for numbers; measure the exact text that drawNumber() prints.
+  char buf[NUMBER_BUF_LEN];
+  DrawTarget::formatNumber(_val, buf);
+  return lcd.textWidth(buf, _fontId);
 }
 
-void FloatLabel::renderText(TFT_eSPI &lcd) {
+void FloatLabel::renderText(DrawTarget &lcd) {
   int16_t childX, childY, childW, childH;
   getChildAreaBoundingBox(childX, childY, childW, childH);
   lcd.drawFloat(_val, _maxDecimalDigits, childX, childY);
@@ -75,21 +127,19 @@ void FloatLabel::setMaxDecimalDigits(uint8_t digits) {
   }
 
   _maxDecimalDigits = digits;
+  textChanged();
 }
 
-int16_t FloatLabel::getContentWidth(TFT_eSPI &lcd) const {
-  if (_val == 0) {
-    return addBorderWidth(lcd.textWidth("0", _fontId));
-  } else {
-    // There is no textWidth() for numbers, but we know the number of digits for
-    // the integer part is proportional to the base10 log of the number, and we
-    // know the max digits we plan to place after the decimal.
-    // TODO(aaron): Can we just drawFloat() someplace offscreen and use the return value of
-    // that method?
-    return addBorderWidth((ceil(log10(fabs(_val))) + _maxDecimalDigits + 1) * lcd.textWidth("0", _fontId));
+void FloatLabel::setValue(float val) {
+  if (val != _val) {
+    _val = val;
+    textChanged();
   }
 }
 
-int16_t FloatLabel::getContentHeight(TFT_eSPI &lcd) const {
-  return addBorderHeight(lcd.fontHeight(_fontId));
+int16_t FloatLabel::measureTextWidth(DrawTarget &lcd) const {
+  // There is no textWidth() for numbers; measure the exact text that drawFloat() prints.
+  char buf[NUMBER_BUF_LEN];
+  DrawTarget::formatFloat(_val, _maxDecimalDigits, buf);
+  return lcd.textWidth(buf, _fontId);
 }
@@ -5,25 +5,42 @@
 
 class Label: public UIWidget {
 public:
-  Label(): UIWidget(), _fontId(0), _color(TFT_WHITE) { };
+  Label(): UIWidget(), _fontId(0), _color(TFT_WHITE), _textWidth(SIZE_NOT_MEASURED),
+      _textHeight(SIZE_NOT_MEASURED) { };
 
   // Sets up the font, color, bg, etc., and then defers to renderText() to text-ify a particular
   // piece of data on this surface with these settings.
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
 
   // Subclasses: Implement how to draw the text representation of the label's reference data.
-  virtual void renderText(TFT_eSPI &lcd) = 0;
+  virtual void renderText(DrawTarget &lcd) = 0;
 
   // TODO(aaron): Handle FreeFont fonts too.
-  void setFont(int fontId) { _fontId = fontId; };
+  void setFont(int fontId);
   void setColor(uint16_t color) { _color = color; };
 
   // TODO(aaron): Handle center and right justification via setTextDatum().
   // TODO(aaron): Implement font size multiplier and set textsize.
 
+  // The size of the text is measured once, and cached until the text or font changes.
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
+
 protected:
+  // Subclasses: Return the width in pixels of the label's text in font _fontId.
+  virtual int16_t measureTextWidth(DrawTarget &lcd) const = 0;
+  // Subclasses: Call when the label's text changes, to update its cached width. This only lays
+  // out the widget tree again if a container measured the old text, and the width changed.
+  void textChanged();
+
   int _fontId;
   uint16_t _color;
+
+private:
+  void _remeasure(bool fontChanged);
+
+  mutable int16_t _textWidth; // Cached measureTextWidth(), or SIZE_NOT_MEASURED.
+  mutable int16_t _textHeight; // Cached font height, or SIZE_NOT_MEASURED.
 };
 
 class StrLabel: public Label {
@@ -31,14 +48,14 @@ public:
   StrLabel(const char *text=NULL): Label(), _str(text) { };
   StrLabel(const String &text): Label(), _str(text.c_str()) { };
 
-  virtual void renderText(TFT_eSPI &lcd);
+  virtual void renderText(DrawTarget &lcd);
 
-  void setText(const char *str) { _str = str; };
-  void setText(const String &str) { _str = str.c_str(); };
+  void setText(const char *str) { _str = str; textChanged(); };
+  void setText(const String &str) { setText(str.c_str()); };
   const char* getText() const { return _str; };
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+protected:
+  virtual int16_t measureTextWidth(DrawTarget &lcd) const;
 
 private:
   const char *_str;
@@ -48,13 +65,13 @@ class IntLabel: public Label {
 public:
   IntLabel(long x=0): Label(), _val(x) { };
 
-  virtual void renderText(TFT_eSPI &lcd);
+  virtual void renderText(DrawTarget &lcd);
 
-  void setValue(long val) { _val = val; };
+  void setValue(long val);
   long getValue() const { return _val; };
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+protected:
+  virtual int16_t measureTextWidth(DrawTarget &lcd) const;
 
 private:
   long _val;
@@ -65,16 +82,16 @@ class FloatLabel: public Label {
 public:
   FloatLabel(float f=0.0f, uint8_t d=7): Label(), _val(f), _maxDecimalDigits(d) { };
 
-  virtual void renderText(TFT_eSPI &lcd);
+  virtual void renderText(DrawTarget &lcd);
 
-  void setValue(float val) { _val = val; };
+  void setValue(float val);
   float getValue() const { return _val; };
 
   void setMaxDecimalDigits(uint8_t digits);
   uint8_t getMaxDecimalDigits() const { return _maxDecimalDigits; };
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+protected:
+  virtual int16_t measureTextWidth(DrawTarget &lcd) const;
 
 private:
   float _val;
@@ -3,10 +3,11 @@
 
 #include "uiwidgets.h"
 
-void Panel::render(TFT_eSPI &lcd, uint32_t renderFlags) {
+void Panel::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
   drawBackground(lcd, renderFlags);
   drawBorder(lcd, renderFlags);
-  if (_child != NULL) {
+  if (_child != NULL && lcd.intersectsClip(_child->getRect())) {
     if (isFocused(renderFlags)) {
       // If this panel is itself focused, propagate that fact to child widget.
       renderFlags |= RF_FOCUSED;
@@ -16,6 +17,7 @@ void Panel::render(TFT_eSPI &lcd, uint32_t renderFlags) {
 }
 
 void Panel::cascadeBoundingBox() {
+  UIW_STATS_SCOPE(_stats, STATS_LAYOUT);
   if (_child == NULL) {
     return; // Nothing to cascade.
   }
@@ -24,10 +26,10 @@ void Panel::cascadeBoundingBox() {
   getChildAreaBoundingBox(childX, childY, childW, childH);
 
   // Pass the entire inner child bounding box on to our sole child.
-  _child->setBoundingBox(childX, childY, childW, childH);
+  setChildBoundingBox(_child, childX, childY, childW, childH);
 }
 
-int16_t Panel::getContentWidth(TFT_eSPI &lcd) const {
+int16_t Panel::getContentWidth(DrawTarget &lcd) const {
   int16_t w = 0;
   if (_child != NULL) {
     w = _child->getContentWidth(lcd);
@@ -36,7 +38,7 @@ int16_t Panel::getContentWidth(TFT_eSPI &lcd) const {
   return addBorderWidth(w);
 }
 
-int16_t Panel::getContentHeight(TFT_eSPI &lcd) const {
+int16_t Panel::getContentHeight(DrawTarget &lcd) const {
   int16_t h = 0;
   if (_child != NULL) {
     h = _child->getContentHeight(lcd);
@@ -45,7 +47,8 @@ int16_t Panel::getContentHeight(TFT_eSPI &lcd) const {
   return addBorderHeight(h);
 }
 
-bool Panel::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
+bool Panel::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
   if (NULL == widget) {
     return false;
   } else if (widget == this) {
@@ -53,9 +56,24 @@ bool Panel::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFl
     return true;
   } else if (containsWidget(widget) && NULL != _child) {
     drawBackgroundUnderWidget(widget, lcd, renderFlags);
-    return _child->redrawChildWidget(widget, lcd);
+    return _child->redrawChildWidget(widget, lcd, renderFlags);
   }
 
   return false;
 }
 
+UIWidget *Panel::getChildContaining(UIWidget *widget) const {
+  if (NULL != _child && _child->containsWidget(widget)) {
+    return _child;
+  }
+
+  return NULL;
+}
+
+UIWidget *Panel::getChildAt(int16_t x, int16_t y) const {
+  if (_child != NULL && _child->containsPoint(x, y)) {
+    return _child;
+  }
+
+  return NULL;
+}
@@ -11,13 +11,15 @@ class Panel : public UIWidget {
 public:
   Panel(): UIWidget(), _child(NULL) {};
 
-  void setChild(UIWidget *widget) { _child = widget; };
+  void setChild(UIWidget *widget) { _child = widget; invalidateLayout(); };
 
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
   virtual void cascadeBoundingBox();
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
-  virtual bool redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+  virtual UIWidget *getChildContaining(UIWidget *widget) const;
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const;
 
 private:
   UIWidget *_child;
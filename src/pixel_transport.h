@@ -0,0 +1,62 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_PIXEL_TRANSPORT_H
+#define __UIW_PIXEL_TRANSPORT_H
+
+/**
+ * Sends rectangles of pixels to a display, possibly in the background (e.g., by DMA), so that the
+ * CPU can draw the next off-screen buffer while the previous one is being transferred.
+ *
+ * Pixels are 16-bit RGB565 values in the byte order a TFT_eSprite stores them in, i.e., the order
+ * they are sent to the display in.
+ */
+class PixelTransport {
+public:
+  PixelTransport() {};
+  virtual ~PixelTransport() {};
+
+  // Start sending the w*h pixels at 'pixels' to the window at (x, y) on the display, first
+  // waiting for any push in progress to finish. This may return before the transfer is complete;
+  // 'pixels' must be left unmodified until isBusy() returns false or waitIdle() returns.
+  virtual void startPush(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) = 0;
+  // Return true if a push is still in progress.
+  virtual bool isBusy() = 0;
+  // Wait for any push in progress to finish.
+  virtual void waitIdle() = 0;
+};
+
+#ifdef UIW_TFT_DMA
+/**
+ * A PixelTransport that uses TFT_eSPI's DMA support. Compile with UIW_TFT_DMA defined to enable
+ * this, if your TFT_eSPI port provides pushImageDMA(). Call lcd.initDMA() before use, and leave
+ * lcd.setSwapBytes() false; sprite pixels are already in the display's byte order.
+ */
+class TftDmaTransport : public PixelTransport {
+public:
+  TftDmaTransport(TFT_eSPI &lcd): PixelTransport(), _lcd(lcd), _active(false) {};
+  virtual ~TftDmaTransport() { waitIdle(); };
+
+  virtual void startPush(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels) {
+    waitIdle();
+    _lcd.startWrite();
+    _lcd.pushImageDMA(x, y, w, h, (uint16_t*)pixels);
+    _active = true;
+  };
+
+  virtual bool isBusy() { return _active && _lcd.dmaBusy(); };
+
+  virtual void waitIdle() {
+    if (_active) {
+      _lcd.dmaWait();
+      _lcd.endWrite();
+      _active = false;
+    }
+  };
+
+private:
+  TFT_eSPI &_lcd;
+  bool _active; // True between startPush() and the waitIdle() that ends the write.
+};
+#endif // UIW_TFT_DMA
+
+#endif // __UIW_PIXEL_TRANSPORT_H
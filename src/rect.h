@@ -0,0 +1,73 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_RECT_H
+#define __UIW_RECT_H
+
+#include <stdint.h>
+
+/** An axis-aligned rectangle in absolute screen pixel coordinates. */
+struct UIRect {
+  int16_t x, y;
+  int16_t w, h;
+
+  bool isEmpty() const { return w <= 0 || h <= 0; };
+  int32_t area() const { return isEmpty() ? 0 : (int32_t)w * h; };
+
+  // Return true if the two rects share at least one pixel.
+  bool intersects(const UIRect &other) const {
+    return x < other.x + other.w && other.x < x + w && y < other.y + other.h && other.y < y + h;
+  };
+
+  bool operator==(const UIRect &other) const {
+    return x == other.x && y == other.y && w == other.w && h == other.h;
+  };
+
+  // Return true if the pixel at (px, py) lies within this rect.
+  bool containsPoint(int16_t px, int16_t py) const {
+    return px >= x && px < x + w && py >= y && py < y + h;
+  };
+
+  // Return true if 'other' lies entirely within this rect.
+  bool contains(const UIRect &other) const {
+    return other.x >= x && other.y >= y && other.x + other.w <= x + w && other.y + other.h <= y + h;
+  };
+
+  /**
+   * Return true if the union of this rect and 'other' is itself exactly a rectangle, i.e. the two
+   * are stacked in the same row or column and overlap or share an edge, or one contains the other.
+   * Merging such rects never claims pixels that neither of them covered.
+   */
+  bool mergesExactlyWith(const UIRect &other) const {
+    if (contains(other) || other.contains(*this)) {
+      return true;
+    } else if (y == other.y && h == other.h) {
+      return x <= other.x + other.w && other.x <= x + w; // same row; overlapping or adjacent.
+    } else if (x == other.x && w == other.w) {
+      return y <= other.y + other.h && other.y <= y + h; // same column; overlapping or adjacent.
+    }
+
+    return false;
+  };
+
+  // Return the area shared by this rect and 'other' (which may be empty).
+  UIRect intersection(const UIRect &other) const {
+    UIRect r;
+    r.x = max(x, other.x);
+    r.y = max(y, other.y);
+    r.w = min(x + w, other.x + other.w) - r.x;
+    r.h = min(y + h, other.y + other.h) - r.y;
+    return r;
+  };
+
+  // Grow this rect to the bounding box of itself and 'other'.
+  void unionWith(const UIRect &other) {
+    int16_t right = max(x + w, other.x + other.w);
+    int16_t bottom = max(y + h, other.y + other.h);
+    x = min(x, other.x);
+    y = min(y, other.y);
+    w = right - x;
+    h = bottom - y;
+  };
+};
+
+#endif // __UIW_RECT_H
@@ -0,0 +1,162 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+#ifdef UIW_ENABLE_STATS
+
+RenderStats uiwStatsTotals;
+
+// Number of StatsScopes currently open for each timer. Time is only added to the running totals
+// when the outermost scope for a timer closes, so nested widgets are not counted twice.
+static uint8_t openScopes[STATS_NUM_TIMERS];
+
+// The innermost StatsScope currently open.
+static StatsScope *curScope = NULL;
+
+StatsScope::StatsScope(RenderStats &dest, uint8_t timer): _dest(dest), _parent(curScope),
+    _timer(timer), _startMicros(micros()), _startDrawCalls(uiwStatsTotals.drawCalls),
+    _startPixels(uiwStatsTotals.pixels), _startGlyphs(uiwStatsTotals.glyphs) {
+  openScopes[_timer]++;
+  curScope = this;
+}
+
+StatsScope::~StatsScope() {
+  uint32_t elapsed = micros() - _startMicros;
+  curScope = _parent;
+  if (--openScopes[_timer] == 0) {
+    uiwStatsTotals.micros[_timer] += elapsed;
+  }
+
+  if (_dest.frame != uiwStatsTotals.frame) {
+    // First activity for this widget in the current frame.
+    _dest.clear();
+    _dest.frame = uiwStatsTotals.frame;
+  }
+
+  _dest.micros[_timer] += elapsed;
+
+  for (StatsScope *outer = _parent; outer != NULL; outer = outer->_parent) {
+    if (&outer->_dest == &_dest) {
+      return; // The enclosing scope will record this draw activity.
+    }
+  }
+
+  _dest.drawCalls += uiwStatsTotals.drawCalls - _startDrawCalls;
+  _dest.pixels += uiwStatsTotals.pixels - _startPixels;
+  _dest.glyphs += uiwStatsTotals.glyphs - _startGlyphs;
+}
+
+// Return the number of characters TFT_eSPI prints for 'val'.
+static uint32_t numberGlyphs(long val) {
+  uint32_t glyphs = 1;
+  if (val < 0) {
+    glyphs++; // '-' sign.
+  }
+
+  while (val <= -10 || val >= 10) {
+    val /= 10;
+    glyphs++;
+  }
+
+  return glyphs;
+}
+
+// Approximate number of pixels along a line; used for outline primitives.
+static int32_t linePixels(int16_t x0, int16_t y0, int16_t x1, int16_t y1) {
+  int32_t dx = x1 > x0 ? x1 - x0 : x0 - x1;
+  int32_t dy = y1 > y0 ? y1 - y0 : y0 - y1;
+  return max(dx, dy) + 1;
+}
+
+void StatsDrawTarget::_count(int32_t pixels, uint32_t glyphs) {
+  uiwStatsTotals.drawCalls++;
+  if (pixels > 0) {
+    uiwStatsTotals.pixels += pixels;
+  }
+  uiwStatsTotals.glyphs += glyphs;
+}
+
+// Count a text draw that rendered 'width' pixels across; returns 'width'.
+int16_t StatsDrawTarget::_countText(int16_t width, uint32_t glyphs) {
+  _count((int32_t)width * _target.fontHeight(_fontId), glyphs);
+  return width;
+}
+
+void StatsDrawTarget::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  _count((int32_t)w * h);
+  _target.fillRect(x, y, w, h, color);
+}
+
+void StatsDrawTarget::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  _count(2 * ((int32_t)w + h));
+  _target.drawRect(x, y, w, h, color);
+}
+
+void StatsDrawTarget::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  _count(w);
+  _target.drawFastHLine(x, y, w, color);
+}
+
+void StatsDrawTarget::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  _count(h);
+  _target.drawFastVLine(x, y, h, color);
+}
+
+void StatsDrawTarget::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  _count(2 * ((int32_t)w + h));
+  _target.drawRoundRect(x, y, w, h, r, color);
+}
+
+void StatsDrawTarget::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  _count((int32_t)w * h);
+  _target.fillRoundRect(x, y, w, h, r, color);
+}
+
+void StatsDrawTarget::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  _count(linePixels(x0, y0, x1, y1) + linePixels(x1, y1, x2, y2) + linePixels(x2, y2, x0, y0));
+  _target.drawTriangle(x0, y0, x1, y1, x2, y2, color);
+}
+
+void StatsDrawTarget::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  int32_t cross = ((int32_t)x1 - x0) * ((int32_t)y2 - y0) - ((int32_t)x2 - x0) * ((int32_t)y1 - y0);
+  _count((cross < 0 ? -cross : cross) / 2);
+  _target.fillTriangle(x0, y0, x1, y1, x2, y2, color);
+}
+
+void StatsDrawTarget::pushImage(int16_t x, int16_t y, int16_t w, int16_t h,
+    const uint16_t *pixels) {
+  _count((int32_t)w * h);
+  _target.pushImage(x, y, w, h, pixels);
+}
+
+bool StatsDrawTarget::copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX,
+    int16_t dstY) {
+  if (!_target.copyRect(x, y, w, h, dstX, dstY)) {
+    return false;
+  }
+
+  _count((int32_t)w * h);
+  return true;
+}
+
+int16_t StatsDrawTarget::drawString(const char *str, int16_t x, int16_t y) {
+  return _countText(_target.drawString(str, x, y), NULL == str ? 0 : strlen(str));
+}
+
+int16_t StatsDrawTarget::drawNumber(long val, int16_t x, int16_t y) {
+  return _countText(_target.drawNumber(val, x, y), numberGlyphs(val));
+}
+
+int16_t StatsDrawTarget::drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y) {
+  uint32_t glyphs = numberGlyphs((long)val) + (decimalDigits > 0 ? decimalDigits + 1 : 0);
+  if (val < 0 && val > -1) {
+    glyphs++; // (long)val drops the sign of e.g. -0.5.
+  }
+  return _countText(_target.drawFloat(val, decimalDigits, x, y), glyphs);
+}
+
+#endif // UIW_ENABLE_STATS
@@ -0,0 +1,130 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_RENDER_STATS_H
+#define __UIW_RENDER_STATS_H
+
+/*
+ * Optional render instrumentation. Define UIW_ENABLE_STATS when compiling the library (e.g.,
+ * `XFLAGS += -DUIW_ENABLE_STATS`) to count draw calls, pixels, and glyphs, and to time render(),
+ * cascadeBoundingBox(), and redrawChildWidget(), per frame (see Screen::getLastFrameStats()) and
+ * per widget (see UIWidget::getRenderStats()). When it is not defined, all of this compiles away.
+ */
+
+#ifdef UIW_ENABLE_STATS
+
+// Which timer a StatsScope charges its elapsed time to.
+constexpr uint8_t STATS_RENDER = 0;
+constexpr uint8_t STATS_LAYOUT = 1;
+constexpr uint8_t STATS_REDRAW = 2;
+constexpr uint8_t STATS_NUM_TIMERS = 3;
+
+struct RenderStats {
+  uint32_t frame;         // Frame number these stats were collected in.
+  uint32_t drawCalls;     // Number of drawing primitives issued.
+  uint32_t pixels;        // (Approximate) number of pixels written by those primitives.
+  uint32_t glyphs;        // Number of text characters drawn.
+  uint32_t micros[STATS_NUM_TIMERS]; // Time spent in render / layout / redraw, in microseconds.
+
+  void clear() { memset(this, 0, sizeof(RenderStats)); };
+};
+
+// Running totals since startup. Frame and widget stats are accumulated from differences in these.
+extern RenderStats uiwStatsTotals;
+
+/**
+ * Records the time elapsed and draw activity that occurs during its lifetime into a RenderStats
+ * record (normally a widget's own), charging the time to the specified timer. If 'dest' was last
+ * written during an earlier frame, it is reset first. Draw activity is only recorded by the
+ * outermost open scope for a given 'dest', so that e.g. redrawChildWidget() calling render() on the
+ * same widget does not count it twice.
+ */
+class StatsScope {
+public:
+  StatsScope(RenderStats &dest, uint8_t timer);
+  ~StatsScope();
+
+private:
+  RenderStats &_dest;
+  StatsScope *_parent; // Enclosing scope, or NULL.
+  uint8_t _timer;
+  uint32_t _startMicros;
+  uint32_t _startDrawCalls;
+  uint32_t _startPixels;
+  uint32_t _startGlyphs;
+};
+
+/**
+ * A DrawTarget that counts the calls, pixels, and glyphs drawn through it into uiwStatsTotals,
+ * and forwards everything to another DrawTarget. The Screen interposes one of these in front of
+ * its DrawTarget when UIW_ENABLE_STATS is defined.
+ */
+class StatsDrawTarget : public DrawTarget {
+public:
+  StatsDrawTarget(DrawTarget &target): DrawTarget(), _target(target), _fontId(1) {};
+
+  virtual int16_t width() { return _target.width(); };
+  virtual int16_t height() { return _target.height(); };
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+
+  virtual void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels);
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY);
+  virtual bool isCopyCheap() { return _target.isCopyCheap(); };
+
+  virtual void setTextFont(uint8_t fontId) { _fontId = fontId; _target.setTextFont(fontId); };
+  virtual void setTextColor(uint16_t fgColor) { _target.setTextColor(fgColor); };
+  virtual void setTextColor(uint16_t fgColor, uint16_t bgColor) {
+    _target.setTextColor(fgColor, bgColor);
+  };
+
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y);
+  virtual int16_t drawNumber(long val, int16_t x, int16_t y);
+  virtual int16_t drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y);
+
+  virtual int16_t textWidth(const char *str, uint8_t fontId) {
+    return _target.textWidth(str, fontId);
+  };
+  virtual int16_t fontHeight(uint8_t fontId) { return _target.fontHeight(fontId); };
+
+  virtual bool beginOffscreen(const UIRect &area) { return _target.beginOffscreen(area); };
+  virtual void endOffscreen() { _target.endOffscreen(); };
+  virtual void finishOffscreen() { _target.finishOffscreen(); };
+  virtual void releaseOffscreen() { _target.releaseOffscreen(); };
+
+  virtual void setClipRect(const UIRect &clip) {
+    DrawTarget::setClipRect(clip);
+    _target.setClipRect(clip);
+  };
+  virtual void clearClipRect() {
+    DrawTarget::clearClipRect();
+    _target.clearClipRect();
+  };
+
+private:
+  void _count(int32_t pixels, uint32_t glyphs=0);
+  int16_t _countText(int16_t width, uint32_t glyphs);
+
+  DrawTarget &_target;
+  uint8_t _fontId;
+};
+
+#define UIW_STATS_SCOPE(dest, timer) StatsScope __uiwStatsScope((dest), (timer))
+
+#else // UIW_ENABLE_STATS
+
+#define UIW_STATS_SCOPE(dest, timer)
+
+#endif // UIW_ENABLE_STATS
+
+#endif // __UIW_RENDER_STATS_H
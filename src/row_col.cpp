@@ -2,185 +2,274 @@
 
 #include "uiwidgets.h"
 
-/////////////////////////////// Rows /////////////////////////////////////
+/////////////////////////////// Span /////////////////////////////////////
 
-Rows::Rows(uint16_t numRows): UIWidget(), _elements(NULL), _heights(NULL) {
-  setNumRows(numRows);
+Span::Span(bool vertical, uint16_t numElements): UIWidget(), _vertical(vertical), _numElements(0),
+    _capacity(0), _uniformSize(0), _elements(NULL), _sizes(NULL), _claimed(NULL) {
+  setNumElements(numElements);
 }
 
-Rows::~Rows() {
-  delete [] _heights;
-  delete [] _elements;
+Span::Span(bool vertical, uint16_t numElements, UIWidget **elements, int16_t *sizes,
+    uint16_t capacity): UIWidget(), _vertical(vertical), _numElements(0), _capacity(capacity),
+    _uniformSize(0), _elements(elements), _sizes(sizes), _claimed(sizes + capacity) {
+  setNumElements(numElements);
+}
+
+Span::~Span() {
+  if (0 == _capacity) {
+    delete [] _sizes;
+    delete [] _elements;
+  }
 }
 
 /**
- * Update the number of rows.
+ * Update the number of elements.
+ *
+ * If there are fewer elements in the new array, the top-most (or left-most) elements are
+ * preserved. You must free any UIWidgets that no longer have a home before calling this method.
  *
- * If there are fewer rows in the new array, the top-most rows are preserved. You must free any
- * UIWidgets that no longer have a home before calling this method.
+ * If there are more elements in the new array, properties like setFixedSize() are not applied to
+ * new elements; you must re-apply them.
  *
- * If there are more rows in the new array, properties like setFixedHeight() are not applied to
- * new row elements; you must re-apply them.
+ * A Span with fixed capacity (see getCapacity()) is limited to that many elements.
  */
-void Rows::setNumRows(uint16_t numRows) {
-  uint16_t oldNumRows = _numRows;
+void Span::setNumElements(uint16_t numElements) {
+  if (_capacity > 0) {
+    numElements = min(max(numElements, (uint16_t)1), _capacity);
+    // Clear any elements dropped from the end, so they start out empty if they're added back.
+    for (uint16_t i = numElements; i < _numElements; i++) {
+      _elements[i] = NULL;
+      _sizes[i] = 0;
+    }
+
+    _numElements = numElements;
+    invalidateLayout();
+    return;
+  }
+
+  uint16_t oldNumElements = _numElements;
   UIWidget **oldElements = _elements;
-  int16_t *oldHeights = _heights;
+  int16_t *oldSizes = _sizes;
 
-  _numRows = numRows;
-  if (_numRows < 1) {
-    _numRows = 1;
+  _numElements = numElements;
+  if (_numElements < 1) {
+    _numElements = 1;
   }
 
-  _elements = new UIWidget*[_numRows]();
-  _heights = new int16_t[_numRows]();
+  _elements = new UIWidget*[_numElements]();
+  _sizes = new int16_t[2 * _numElements]();
+  _claimed = _sizes + _numElements;
 
   if (oldElements != NULL) {
     // Transfer over the elements and sizes that carry into the newly sized container.
-    for (uint16_t i = 0; i < min(oldNumRows, _numRows); i++) {
+    for (uint16_t i = 0; i < min(oldNumElements, _numElements); i++) {
       _elements[i] = oldElements[i];
-      _heights[i] = oldHeights[i];
+      _sizes[i] = oldSizes[i];
     }
 
     delete [] oldElements;
-    delete [] oldHeights;
+    delete [] oldSizes;
   }
 
-  cascadeBoundingBox();
+  invalidateLayout();
 }
 
-void Rows::render(TFT_eSPI &lcd, uint32_t renderFlags) {
+void Span::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
   drawBackground(lcd, renderFlags);
   drawBorder(lcd, renderFlags);
 
-  // TODO(aaron): If widgets have FLEX sizing, dynamically adjust the bounding boxes of all
-  // elements before rendering each element.
-
   if (isFocused(renderFlags)) {
     renderFlags |= RF_FOCUSED; // propagate our focused nature to any child element(s).
   }
 
-  for (uint16_t i = 0; i < _numRows; i++) {
+  for (uint16_t i = 0; i < _numElements; i++) {
     UIWidget *widget = _elements[i];
-    if (widget != NULL) {
-      widget->render(lcd, renderFlags);
+    if (widget != NULL && lcd.intersectsClip(widget->getRect())) {
+      widget->render(lcd, renderFlags); // Skip children entirely outside the clip rect.
     }
   }
 }
 
-void Rows::cascadeBoundingBox() {
+void Span::cascadeBoundingBox() {
+  UIW_STATS_SCOPE(_stats, STATS_LAYOUT);
   // Get the inner bounding box.
   int16_t childX, childY, childW, childH;
   getChildAreaBoundingBox(childX, childY, childW, childH);
-
-  // To calculate how much space is given to EQUAL rows, we first subtract
-  // the heights of any explicitly-set rows; EQUAL rows then share all the
-  // space that is not explicitly claimed equally.
-  int16_t claimedHeight = 0;
-  int16_t rowsWithClaimedHeight = 0;
-  for (uint16_t i = 0; i < _numRows; i++) {
-    if (_heights[i] >= 0) {
-      claimedHeight += _heights[i];
-      rowsWithClaimedHeight++;
+  const int16_t available = _vertical ? childH : childW;
+
+  // To calculate how much space is given to EQUAL elements, we first subtract
+  // the sizes of any explicitly-sized elements and the measured content sizes of
+  // FLEX elements; EQUAL elements then share all the space that is not claimed equally.
+  // Each FLEX element is measured just once, into _claimed[], as a nested container measures its
+  // whole subtree.
+  int16_t claimedSize = 0;
+  int16_t elemsWithClaimedSize = 0;
+  for (uint16_t i = 0; i < _numElements; i++) {
+    int16_t size = _claimedSize(i);
+    _claimed[i] = size;
+    if (size >= 0) {
+      claimedSize += size;
+      elemsWithClaimedSize++;
     }
   }
 
-  int16_t equalRowsAvailableHeight = max(0, childH - claimedHeight);
-  int16_t equalRowsCount = _numRows - rowsWithClaimedHeight;
-  // This gives us the actual height to apportion to a row configured to EQUAL sizing.
-  const int16_t equalRowHeight = equalRowsAvailableHeight / max(equalRowsCount, 1);
+  int16_t equalAvailableSize = max(0, available - claimedSize);
+  int16_t equalCount = _numElements - elemsWithClaimedSize;
+  // This gives us the actual size to apportion to an element configured to EQUAL sizing.
+  const int16_t equalSize = equalAvailableSize / max(equalCount, 1);
+
+  // Now calculate the actual sizes/offsets of each element.
+  _uniformSize = -1;
+  for (uint16_t i = 0; i < _numElements; i++) {
+    int16_t size = _claimed[i];
+    if (size == EQUAL) {
+      size = equalSize;
+    } else {
+      size = min(size, available);
+    }
 
-  // Now calculate the actual heights/offsets of each row.
-  for (uint16_t i = 0; i < _numRows; i++) {
-    int16_t elemH = min(_heights[i], childH);
-    if (_heights[i] == EQUAL) {
-      elemH = equalRowHeight;
+    if (_uniformSize == -1) {
+      _uniformSize = size;
+    } else if (_uniformSize != size) {
+      _uniformSize = 0; // Elements differ in size.
     }
 
-    // TODO(aaron): Handle FLEX sizing.
-    if (_elements[i] != NULL) {
-      _elements[i]->setBoundingBox(childX, childY, childW, elemH);
+    UIWidget *widget = _elements[i];
+    if (_vertical) {
+      if (widget != NULL) {
+        setChildBoundingBox(widget, childX, childY, childW, size);
+      }
+      childY += size; // Next row is lower down, by the height of this elem.
+    } else {
+      if (widget != NULL) {
+        setChildBoundingBox(widget, childX, childY, size, childH);
+      }
+      childX += size; // Next col is further to the right, by the width of this elem.
     }
+  }
 
-    childY += elemH; // Next row is lower down, by the height of this elem.
+  _uniformSize = max(_uniformSize, (int16_t)0);
+}
+
+/**
+ * Return the size claimed by an element: its fixed size, or for a FLEX element, the content size
+ * of its widget along this Span's axis. Returns EQUAL for elements that share the unclaimed space.
+ */
+int16_t Span::_claimedSize(uint16_t offset) const {
+  if (_sizes[offset] != FLEX) {
+    return _sizes[offset];
+  } else if (NULL == _layoutTarget) {
+    return EQUAL; // No way to measure content outside of a Screen.
+  } else if (NULL == _elements[offset]) {
+    return 0;
   }
+
+  return _mainContentSize(_elements[offset], *_layoutTarget);
 }
 
 /**
  * Sets the element at the specified offset. If this clobbers an existing UIWidget,
  * you must free it first.
  */
-void Rows::setRow(uint16_t offset, UIWidget *widget, int16_t height) {
-  if (offset >= _numRows) {
+void Span::setElement(uint16_t offset, UIWidget *widget, int16_t size) {
+  if (offset >= _numElements) {
     return; // Invalid.
   }
 
   _elements[offset] = widget;
-  _heights[offset] = height;
-  cascadeBoundingBox();
+  _sizes[offset] = size;
+  invalidateLayout();
 }
 
-void Rows::setFixedHeight(int16_t height) {
-  for (uint16_t i = 0; i < _numRows; i++) {
-    _heights[i] = height;
+void Span::setFixedSize(int16_t size) {
+  for (uint16_t i = 0; i < _numElements; i++) {
+    _sizes[i] = size;
   }
 
-  cascadeBoundingBox();
+  invalidateLayout();
 }
 
-void Rows::setRowHeight(uint16_t offset, int16_t height) {
-  if (offset >= _numRows) {
+void Span::setElementSize(uint16_t offset, int16_t size) {
+  if (offset >= _numElements) {
     return; // Invalid.
   }
 
-  _heights[offset] = height;
-  cascadeBoundingBox();
+  _sizes[offset] = size;
+  invalidateLayout();
 }
 
-int16_t Rows::getRowHeight(uint16_t offset) {
-  if (offset >= _numRows) {
+int16_t Span::getElementSize(uint16_t offset) const {
+  if (offset >= _numElements) {
     return ERROR_INVALID_ELEMENT; // Invalid.
   }
 
-  return _heights[offset];
+  return _sizes[offset];
 }
 
-int16_t Rows::getContentWidth(TFT_eSPI &lcd) const {
-  // The width required for a Rows is the max width required by any child.
-  int16_t w = 0;
-  for (int i = 0; i < _numRows; i++) {
-    if (_elements[i] != NULL) {
-      w = max(w, _elements[i]->getContentWidth(lcd));
+int16_t Span::getContentWidth(DrawTarget &lcd) const {
+  // A Rows is as wide as its widest child; a Cols is as wide as the sum of its column widths.
+  if (_vertical) {
+    return addBorderWidth(_maxContentSize(lcd));
+  }
+
+  int16_t w = _sumContentSizes(lcd);
+  return w == EQUAL ? _w : addBorderWidth(w);
+}
+
+int16_t Span::getContentHeight(DrawTarget &lcd) const {
+  // A Rows is as tall as the sum of its row heights; a Cols is as tall as its tallest child.
+  if (!_vertical) {
+    return addBorderHeight(_maxContentSize(lcd));
+  }
+
+  int16_t h = _sumContentSizes(lcd);
+  return h == EQUAL ? _h : addBorderHeight(h);
+}
+
+/**
+ * Return the sum of the sizes allocated to the elements along this Span's axis, with FLEX
+ * elements taking the content size of their children. If any element is allocated EQUAL size,
+ * return EQUAL; the Span will expand to its entire allocated area.
+ */
+int16_t Span::_sumContentSizes(DrawTarget &lcd) const {
+  int16_t total = 0;
+  for (uint16_t i = 0; i < _numElements; i++) {
+    if (_sizes[i] == EQUAL) {
+      return EQUAL;
+    } else if (_sizes[i] == FLEX) {
+      total += _elements[i] == NULL ? 0 : _mainContentSize(_elements[i], lcd);
+    } else {
+      total += _sizes[i];
     }
   }
 
-  return addBorderWidth(w);
+  return total;
 }
 
-int16_t Rows::getContentHeight(TFT_eSPI &lcd) const {
-  // The height required for a Rows is the sum of the row heights allocated to the children.
-  // If any child is allocated EQUAL or FLEX height, return the entire height of this object.
-  int16_t h = 0;
-  for (int i = 0; i < _numRows; i++) {
-    if (_heights[i] == EQUAL || _heights[i] == FLEX) {
-      return _h; // We're going to expand to our entire allocated area.
+// Return the max size required by any child across this Span's axis.
+int16_t Span::_maxContentSize(DrawTarget &lcd) const {
+  int16_t size = 0;
+  for (uint16_t i = 0; i < _numElements; i++) {
+    if (_elements[i] != NULL) {
+      size = max(size, _crossContentSize(_elements[i], lcd));
     }
-    h += _heights[i];
   }
 
-  return addBorderHeight(h);
+  return size;
 }
 
-bool Rows::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
+bool Span::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
   if (NULL == widget) {
     return false;
   } else if (this == widget) {
     render(lcd, renderFlags);
     return true;
   } else if (containsWidget(widget)) {
-    for (unsigned int i = 0; i < _numRows; i++) {
+    for (uint16_t i = 0; i < _numElements; i++) {
       if (_elements[i] != NULL && _elements[i]->containsWidget(widget)) {
-        // Found the row containing the widget.
+        // Found the element containing the widget.
         drawBackgroundUnderWidget(widget, lcd, renderFlags);
         return _elements[i]->redrawChildWidget(widget, lcd, renderFlags);
       }
@@ -190,193 +279,35 @@ bool Rows::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFla
   return false;
 }
 
-/////////////////////////////// Cols /////////////////////////////////////
-// TODO(aaron): This is unfortunately a near code-clone of Rows, but for the
-// nomenclature used (row vs col; height vs width). This should all likely be
-// refactored into a single Span element and then have Rows and Cols subclass it
-// for direction.
-
-Cols::Cols(uint16_t numCols): UIWidget(), _elements(NULL), _widths(NULL) {
-  setNumCols(numCols);
-}
-
-Cols::~Cols() {
-  delete [] _widths;
-  delete [] _elements;
-}
-
-/**
- * Update the number of columns.
- *
- * If there are fewer cols in the new array, the left-most cols are preserved. You must free any
- * UIWidgets that no longer have a home before calling this method.
- *
- * If there are more cols in the new array, properties like setFixedWidth() are not applied to
- * new column elements; you must re-apply them.
- */
-void Cols::setNumCols(uint16_t numCols) {
-  uint16_t oldNumCols = _numCols;
-  UIWidget **oldElements = _elements;
-  int16_t *oldWidths = _widths;
-
-  _numCols = numCols;
-  if (_numCols < 1) {
-    _numCols = 1;
-  }
-
-  _elements = new UIWidget*[_numCols]();
-  _widths = new int16_t[_numCols]();
-
-  if (oldElements != NULL) {
-    // Transfer over the elements and sizes that carry into the newly sized container.
-    for (uint16_t i = 0; i < min(oldNumCols, _numCols); i++) {
-      _elements[i] = oldElements[i];
-      _widths[i] = oldWidths[i];
+UIWidget *Span::getChildContaining(UIWidget *widget) const {
+  for (uint16_t i = 0; i < _numElements; i++) {
+    if (_elements[i] != NULL && _elements[i]->containsWidget(widget)) {
+      return _elements[i];
     }
-
-    delete [] oldElements;
-    delete [] oldWidths;
   }
 
-  cascadeBoundingBox();
+  return NULL;
 }
 
-void Cols::render(TFT_eSPI &lcd, uint32_t renderFlags) {
-  drawBackground(lcd, renderFlags);
-  drawBorder(lcd, renderFlags);
-
-  // TODO(aaron): If widgets have FLEX sizing, dynamically adjust the bounding boxes of all
-  // elements before rendering each element.
-
-  if (isFocused(renderFlags)) {
-    renderFlags |= RF_FOCUSED; // propagate our focused nature to any child element(s).
-  }
-
-  for (uint16_t i = 0; i < _numCols; i++) {
-    UIWidget *widget = _elements[i];
-    if (widget != NULL) {
-      widget->render(lcd, renderFlags);
+UIWidget *Span::getChildAt(int16_t x, int16_t y) const {
+  if (_uniformSize > 0) {
+    // Every element is the same size, so the one at (x, y) can be found directly.
+    int16_t childX, childY, childW, childH;
+    getChildAreaBoundingBox(childX, childY, childW, childH);
+    int16_t offset = _vertical ? y - childY : x - childX;
+    if (offset < 0 || offset / _uniformSize >= _numElements) {
+      return NULL;
     }
-  }
-}
-
-void Cols::cascadeBoundingBox() {
-  // Get the inner bounding box.
-  int16_t childX, childY, childW, childH;
-  getChildAreaBoundingBox(childX, childY, childW, childH);
-
-  // To calculate how much space is given to EQUAL columns, we first subtract
-  // the widths of any explicitly-set columns; EQUAL columns then share all the
-  // space that is not explicitly claimed equally.
-  int16_t claimedWidth = 0;
-  int16_t colsWithClaimedWidth = 0;
-  for (uint16_t i = 0; i < _numCols; i++) {
-    if (_widths[i] >= 0) {
-      claimedWidth += _widths[i];
-      colsWithClaimedWidth++;
-    }
-  }
-  int16_t equalColsAvailableWidth = max(0, childW - claimedWidth);
-  int16_t equalColsCount = _numCols - colsWithClaimedWidth;
-  // This gives us the actual width to apportion to a col configured to EQUAL sizing.
-  const int16_t equalColWidth = equalColsAvailableWidth / max(equalColsCount, 1);
-
-  // Now calculate the actual widths/offsets of each col.
-  for (uint16_t i = 0; i < _numCols; i++) {
-    int16_t elemW = min(_widths[i], childW);
-    if (_widths[i] == EQUAL) {
-      elemW = equalColWidth;
-    }
-
-    // TODO(aaron): Handle FLEX sizing.
-    if (_elements[i] != NULL) {
-      _elements[i]->setBoundingBox(childX, childY, elemW, childH);
-    }
-
-    childX += elemW; // Next col is further to the right, by the width of this elem.
-  }
-}
-
-/**
- * Sets the element at the specified offset. If this clobbers an existing UIWidget,
- * you must free it first.
- */
-void Cols::setColumn(uint16_t offset, UIWidget *widget, int16_t width) {
-  if (offset >= _numCols) {
-    return; // Invalid.
-  }
-
-  _elements[offset] = widget;
-  _widths[offset] = width;
-  cascadeBoundingBox();
-}
-
-void Cols::setFixedWidth(int16_t width) {
-  for (uint16_t i = 0; i < _numCols; i++) {
-    _widths[i] = width;
-  }
-
-  cascadeBoundingBox();
-}
 
-void Cols::setColumnWidth(uint16_t offset, int16_t width) {
-  if (offset >= _numCols) {
-    return; // Invalid.
-  }
-
-  _widths[offset] = width;
-  cascadeBoundingBox();
-}
-
-int16_t Cols::getColumnWidth(uint16_t offset) {
-  if (offset >= _numCols) {
-    return ERROR_INVALID_ELEMENT; // Invalid.
-  }
-
-  return _widths[offset];
-}
-
-int16_t Cols::getContentHeight(TFT_eSPI &lcd) const {
-  // The height required for a Cols is the max height required by any child.
-  int16_t h = 0;
-  for (int i = 0; i < _numCols; i++) {
-    if (_elements[i] != NULL) {
-      h = max(h, _elements[i]->getContentHeight(lcd));
-    }
-  }
-
-  return addBorderHeight(h);
-}
-
-int16_t Cols::getContentWidth(TFT_eSPI &lcd) const {
-  // The width required for a Cols is the sum of the col widths allocated to the children.
-  // If any child is allocated EQUAL or FLEX height, return the entire width of this object.
-  int16_t w = 0;
-  for (int i = 0; i < _numCols; i++) {
-    if (_widths[i] == EQUAL || _widths[i] == FLEX) {
-      return _w; // We're going to expand to our entire allocated area.
-    }
-    w += _widths[i];
+    UIWidget *widget = _elements[offset / _uniformSize];
+    return (widget != NULL && widget->containsPoint(x, y)) ? widget : NULL;
   }
 
-  return addBorderWidth(w);
-}
-
-bool Cols::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
-  if (NULL == widget) {
-    return false;
-  } else if (this == widget) {
-    render(lcd, renderFlags);
-    return true;
-  } else if (containsWidget(widget)) {
-    for (unsigned int i = 0; i < _numCols; i++) {
-      if (_elements[i] != NULL && _elements[i]->containsWidget(widget)) {
-        // Found the column containing the widget.
-        drawBackgroundUnderWidget(widget, lcd, renderFlags);
-        return _elements[i]->redrawChildWidget(widget, lcd, renderFlags);
-      }
+  for (uint16_t i = 0; i < _numElements; i++) {
+    if (_elements[i] != NULL && _elements[i]->containsPoint(x, y)) {
+      return _elements[i];
     }
   }
 
-  return false;
+  return NULL;
 }
@@ -5,62 +5,146 @@
 
 #include "screen.h"
 
-class Rows: public UIWidget {
+/**
+ * A Span lays out a line of child widgets along one axis: top-to-bottom if vertical, or
+ * left-to-right if horizontal. Each child is given its own size along that axis (in pixels, or
+ * EQUAL or FLEX) and the full size of the Span's child area across it.
+ *
+ * Rows and Cols are Spans in each direction; use those rather than a Span directly. FixedRows and
+ * FixedCols hold their elements inline rather than on the heap.
+ */
+class Span: public UIWidget {
 public:
-  Rows(uint16_t numRows);
-  ~Rows();
+  ~Span();
 
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
   virtual void cascadeBoundingBox();
 
-  void setNumRows(uint16_t numRows); // update number of rows. Properties like fixed height do not carry
-                                     // over to any new rows.
-  uint16_t getNumRows() const { return _numRows; };
-  void setRow(uint16_t offset, UIWidget *widget, int16_t height);
-  void setFixedHeight(int16_t height); // a height applied to each row.
-  // Row height in pixels, or EQUAL to evenly distribute rows, or FLEX to use content-sensitive
-  // sizing.
-  void setRowHeight(uint16_t offset, int16_t height);
-  int16_t getRowHeight(uint16_t offset);
+  // Update the number of elements. Properties like fixed size do not carry over to any new
+  // elements.
+  void setNumElements(uint16_t numElements);
+  uint16_t getNumElements() const { return _numElements; };
+  // Return the max number of elements, or 0 if the Span allocates as many as it needs.
+  uint16_t getCapacity() const { return _capacity; };
+  void setElement(uint16_t offset, UIWidget *widget, int16_t size);
+  void setFixedSize(int16_t size); // a size applied to each element.
+  // Element size in pixels along this Span's axis, or EQUAL to evenly distribute elements, or
+  // FLEX to use content-sensitive sizing.
+  void setElementSize(uint16_t offset, int16_t size);
+  int16_t getElementSize(uint16_t offset) const;
+
+  bool isVertical() const { return _vertical; };
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
 
-  virtual bool redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+  virtual UIWidget *getChildContaining(UIWidget *widget) const;
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const;
+
+protected:
+  Span(bool vertical, uint16_t numElements);
+  // Use caller-provided arrays of 'capacity' elements and 2 * 'capacity' sizes (the second half
+  // being scratch space for layout), which must be zeroed, instead of allocating them.
+  Span(bool vertical, uint16_t numElements, UIWidget **elements, int16_t *sizes,
+      uint16_t capacity);
 
 private:
-  uint16_t _numRows;
-  UIWidget **_elements; // one for each row.
-  int16_t *_heights; // one for each row.
+  // Content size of 'widget' along (or across) this Span's axis.
+  int16_t _mainContentSize(const UIWidget *widget, DrawTarget &lcd) const {
+    return _vertical ? widget->getContentHeight(lcd) : widget->getContentWidth(lcd);
+  };
+  int16_t _crossContentSize(const UIWidget *widget, DrawTarget &lcd) const {
+    return _vertical ? widget->getContentWidth(lcd) : widget->getContentHeight(lcd);
+  };
+
+  int16_t _claimedSize(uint16_t offset) const;
+  int16_t _sumContentSizes(DrawTarget &lcd) const;
+  int16_t _maxContentSize(DrawTarget &lcd) const;
+
+  const bool _vertical; // True to lay out elements top-to-bottom; false for left-to-right.
+  uint16_t _numElements;
+  uint16_t _capacity; // Length of caller-provided arrays, or 0 if they're allocated by the Span.
+  // If the last layout gave every element the same size, that size (so the element at a given
+  // point can be found by division); otherwise 0.
+  int16_t _uniformSize;
+  UIWidget **_elements; // one for each element.
+  int16_t *_sizes; // one for each element.
+  // Size claimed by each element (see _claimedSize()), measured once per layout; carved out of
+  // the same array as _sizes.
+  int16_t *_claimed;
 };
 
-class Cols: public UIWidget {
+/** A Span that stacks its elements top-to-bottom; each row has its own height. */
+class Rows: public Span {
 public:
-  Cols(uint16_t numCols);
-  ~Cols();
+  Rows(uint16_t numRows): Span(true, numRows) {};
 
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
-  virtual void cascadeBoundingBox();
+  void setNumRows(uint16_t numRows) { setNumElements(numRows); };
+  uint16_t getNumRows() const { return getNumElements(); };
+  void setRow(uint16_t offset, UIWidget *widget, int16_t height) {
+    setElement(offset, widget, height);
+  };
+  void setFixedHeight(int16_t height) { setFixedSize(height); }; // a height applied to each row.
+  // Row height in pixels, or EQUAL to evenly distribute rows, or FLEX to use content-sensitive
+  // sizing.
+  void setRowHeight(uint16_t offset, int16_t height) { setElementSize(offset, height); };
+  int16_t getRowHeight(uint16_t offset) const { return getElementSize(offset); };
+
+protected:
+  friend class WidgetArena;
+  Rows(uint16_t numRows, UIWidget **elements, int16_t *heights, uint16_t capacity):
+      Span(true, numRows, elements, heights, capacity) {};
+};
+
+/** A Span that places its elements left-to-right; each column has its own width. */
+class Cols: public Span {
+public:
+  Cols(uint16_t numCols): Span(false, numCols) {};
 
-  void setNumCols(uint16_t numCols); // update number of cols. Properties like fixed height do not carry
-                                     // over to any new cols.
-  uint16_t getNumCols() const { return _numCols; };
-  void setColumn(uint16_t offset, UIWidget *widget, int16_t width);
-  void setFixedWidth(int16_t width); // a width applied to each column.
+  void setNumCols(uint16_t numCols) { setNumElements(numCols); };
+  uint16_t getNumCols() const { return getNumElements(); };
+  void setColumn(uint16_t offset, UIWidget *widget, int16_t width) {
+    setElement(offset, widget, width);
+  };
+  void setFixedWidth(int16_t width) { setFixedSize(width); }; // a width applied to each column.
   // Col width in pixels, or EQUAL to evenly distribute columns, or FLEX to use content-sensitive
   // sizing.
-  void setColumnWidth(uint16_t offset, int16_t width);
-  int16_t getColumnWidth(uint16_t offset);
+  void setColumnWidth(uint16_t offset, int16_t width) { setElementSize(offset, width); };
+  int16_t getColumnWidth(uint16_t offset) const { return getElementSize(offset); };
+
+protected:
+  friend class WidgetArena;
+  Cols(uint16_t numCols, UIWidget **elements, int16_t *widths, uint16_t capacity):
+      Span(false, numCols, elements, widths, capacity) {};
+};
 
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+/**
+ * A Rows with room for up to N rows held within the object itself, so it never allocates memory.
+ * It behaves just like a Rows, except that setNumRows() is limited to N rows.
+ */
+template<uint16_t N> class FixedRows: public Rows {
+public:
+  FixedRows(uint16_t numRows = N): Rows(numRows, _elementStore, _heightStore, N),
+      _elementStore(), _heightStore() {};
 
-  virtual bool redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+private:
+  UIWidget *_elementStore[N];
+  int16_t _heightStore[2 * N];
+};
+
+/**
+ * A Cols with room for up to N columns held within the object itself, so it never allocates
+ * memory. It behaves just like a Cols, except that setNumCols() is limited to N columns.
+ */
+template<uint16_t N> class FixedCols: public Cols {
+public:
+  FixedCols(uint16_t numCols = N): Cols(numCols, _elementStore, _widthStore, N),
+      _elementStore(), _widthStore() {};
 
 private:
-  uint16_t _numCols;
-  UIWidget **_elements; // one for each col.
-  int16_t *_widths; // one for each col
+  UIWidget *_elementStore[N];
+  int16_t _widthStore[2 * N];
 };
 
 #endif
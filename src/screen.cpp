@@ -3,11 +3,116 @@
 
 #include "uiwidgets.h"
 
+/**
+ * Combine the render flags of two queued redraws of the same widget into one set of flags
+ * that redraws at least as much as either of them would.
+ */
+static uint32_t mergeRenderFlags(uint32_t a, uint32_t b) {
+  uint32_t merged = (a | b) & ~RF_NO_BACKGROUNDS;
+  merged |= a & b & RF_NO_BACKGROUNDS; // Only suppress backgrounds if neither redraw wants them.
+
+  if ((a & RF_WIDGET_SPECIFIC) == 0 || (b & RF_WIDGET_SPECIFIC) == 0) {
+    // A full redraw of the widget subsumes any widget-specific partial redraw.
+    merged &= ~RF_WIDGET_SPECIFIC_MASK;
+  }
+
+  return merged;
+}
+
+/**
+ * Return true if redrawing 'outer' with 'outerFlags' also repaints everything that redrawing
+ * 'inner' with 'innerFlags' would.
+ */
+static bool redrawCovers(UIWidget *outer, uint32_t outerFlags, UIWidget *inner, uint32_t innerFlags) {
+  if ((outerFlags & RF_WIDGET_SPECIFIC) != 0) {
+    return false; // 'outer' is only partially redrawn.
+  } else if ((outerFlags & RF_NO_BACKGROUNDS) > (innerFlags & RF_NO_BACKGROUNDS)) {
+    return false; // 'inner' needs backgrounds that 'outer' would not draw.
+  } else if ((innerFlags & RF_FOCUSED) > (outerFlags & RF_FOCUSED)) {
+    return false; // 'inner' must be drawn focused.
+  }
+
+  return outer->containsWidget(inner);
+}
+
+#ifdef UIW_ENABLE_STATS
+// Route all drawing through a StatsDrawTarget so that it is counted.
+#define SCREEN_DRAW_TARGET(target) _statsTarget(target), _lcd(_statsTarget)
+#else
+#define SCREEN_DRAW_TARGET(target) _lcd(target)
+#endif
+
+Screen::Screen(TFT_eSPI &lcd): _tftTarget(new TftDrawTarget(lcd)),
+    SCREEN_DRAW_TARGET(*_tftTarget),
+    _offscreen(false), _drawingOffscreen(false), _bandHeight(0),
+    _widget(NULL), _layoutVersion(0), _bgColor(TFT_BLACK), _lastBgPixels(0),
+    _numDirty(0), _fullRedrawPending(false), _numPlanned(0), _plannedBoundsVersion(0),
+    _numRegions(0), _curRegion(0) {
+#ifdef UIW_ENABLE_STATS
+  _lastFrameStats.clear();
+#endif
+}
+
+Screen::Screen(DrawTarget &target): _tftTarget(NULL), SCREEN_DRAW_TARGET(target),
+    _offscreen(false), _drawingOffscreen(false), _bandHeight(0),
+    _widget(NULL), _layoutVersion(0), _bgColor(TFT_BLACK), _lastBgPixels(0),
+    _numDirty(0), _fullRedrawPending(false), _numPlanned(0), _plannedBoundsVersion(0),
+    _numRegions(0), _curRegion(0) {
+#ifdef UIW_ENABLE_STATS
+  _lastFrameStats.clear();
+#endif
+}
+
+Screen::~Screen() {
+  if (UIWidget::_layoutTarget == &_lcd) {
+    UIWidget::_layoutTarget = NULL;
+  }
+  delete _tftTarget;
+}
+
+void Screen::setOffscreenRendering(bool enable) {
+  _offscreen = enable;
+  if (!enable) {
+    _lcd.releaseOffscreen();
+  }
+}
+
+void Screen::setBandHeight(int16_t lines) {
+  _bandHeight = max(lines, (int16_t)0);
+  _lcd.releaseOffscreen();
+}
+
 void Screen::render(uint32_t renderFlags) {
-  _lcd.fillScreen(_bgColor);
-  if (NULL != _widget) {
-    _widget->render(_lcd, renderFlags);
+  _discardRedraws(); // Everything is about to be repainted.
+  UIRect screenRect = { 0, 0, getWidth(), getHeight() };
+  renderRect(screenRect, renderFlags);
+}
+
+void Screen::renderRect(const UIRect &area, uint32_t renderFlags) {
+  UIRect screenRect = { 0, 0, getWidth(), getHeight() };
+  UIRect drawArea = area.intersection(screenRect);
+  if (drawArea.isEmpty()) {
+    return;
+  }
+
+  _beginFrame();
+  UIWidget::_bgPixelsWritten = 0;
+  updateLayout();
+
+  bool covered = _bgColor != TRANSPARENT_COLOR;
+  for (UIRect band = _firstBand(drawArea, covered); !band.isEmpty();
+      band = _nextBand(drawArea, band)) {
+    _beginDraw(band, covered);
+    _fillBackground(band, _bgColor);
+    if (NULL != _widget) {
+      _widget->render(_lcd, renderFlags);
+    }
+    _endDraw();
   }
+  _lcd.finishOffscreen();
+
+  _lastBgPixels = UIWidget::_bgPixelsWritten;
+  _endFrame();
 }
 
 void Screen::renderWidget(UIWidget *widget, uint32_t renderFlags) {
@@ -15,17 +120,455 @@ void Screen::renderWidget(UIWidget *widget, uint32_t renderFlags) {
     return;
   }
 
-  if (_bgColor != TRANSPARENT_COLOR && (renderFlags & RF_NO_BACKGROUNDS) == 0) {
-    _lcd.fillRect(widget->_x, widget->_y, widget->_w, widget->_h, _bgColor);
+  _beginFrame();
+  UIWidget::_bgPixelsWritten = 0;
+  updateLayout();
+
+  uint16_t bgColor;
+  if (_findBackground(widget, renderFlags, bgColor)) {
+    // Repaint 'widget' directly, rather than descending to it from the top-level widget.
+    UIRect area = widget->getRect();
+    bool covered = bgColor != TRANSPARENT_COLOR || widget->isOpaque(renderFlags);
+    for (UIRect band = _firstBand(area, covered); !band.isEmpty(); band = _nextBand(area, band)) {
+      _beginDraw(band, covered);
+      _fillBackground(band, bgColor);
+      widget->redrawChildWidget(widget, _lcd, renderFlags | RF_PARENT_BG_DRAWN);
+      _endDraw();
+    }
+    _lcd.finishOffscreen();
+  }
+
+  _lastBgPixels = UIWidget::_bgPixelsWritten;
+  _endFrame();
+}
+
+void Screen::invalidate(UIWidget *widget, uint32_t renderFlags) {
+  if (NULL == widget || _fullRedrawPending) {
+    return; // Nothing to do, or already slated to redraw everything.
+  }
+
+  updateLayout(); // Coalescing below compares bounding boxes.
+
+  for (uint8_t i = 0; i < _numDirty; i++) {
+    if (_dirtyWidgets[i] == widget) {
+      _dirtyFlags[i] = mergeRenderFlags(_dirtyFlags[i], renderFlags);
+      return;
+    } else if (redrawCovers(_dirtyWidgets[i], _dirtyFlags[i], widget, renderFlags)) {
+      return; // An ancestor is already queued for redraw.
+    }
+  }
+
+  // Drop any queued descendants that this redraw makes redundant.
+  uint8_t numKept = 0;
+  for (uint8_t i = 0; i < _numDirty; i++) {
+    if (!redrawCovers(widget, renderFlags, _dirtyWidgets[i], _dirtyFlags[i])) {
+      _dirtyWidgets[numKept] = _dirtyWidgets[i];
+      _dirtyFlags[numKept] = _dirtyFlags[i];
+      numKept++;
+    }
+  }
+  _numDirty = numKept;
+
+  if (_numDirty == SCREEN_MAX_DIRTY_WIDGETS) {
+    // Queue overflow; give up on tracking individual widgets.
+    _numDirty = 0;
+    _fullRedrawPending = true;
+    return;
+  }
+
+  _dirtyWidgets[_numDirty] = widget;
+  _dirtyFlags[_numDirty] = renderFlags;
+  _numDirty++;
+}
+
+void Screen::flush() {
+  if (!hasPendingRedraw()) {
+    return;
+  }
+
+  _beginFrame();
+  UIWidget::_bgPixelsWritten = 0;
+  updateLayout();
+
+  while (_redrawStep()) {
+  }
+
+  _lastBgPixels = UIWidget::_bgPixelsWritten;
+  _endFrame();
+}
+
+bool Screen::tick(uint32_t budgetMicros) {
+  if (!hasPendingRedraw()) {
+    return false;
+  }
+
+  uint32_t start = micros();
+  _beginFrame();
+  UIWidget::_bgPixelsWritten = 0;
+  updateLayout();
+
+  // Always make some progress, even if the budget is smaller than one step.
+  while (_redrawStep() && micros() - start < budgetMicros) {
+  }
+
+  _lastBgPixels = UIWidget::_bgPixelsWritten;
+  _endFrame();
+  return hasPendingRedraw();
+}
+
+/**
+ * Draw the next band of the redraw in progress, first planning a new redraw from the widgets
+ * queued by invalidate() if the previous one is complete. Returns false if there was nothing left
+ * to draw.
+ */
+bool Screen::_redrawStep() {
+  if (_curRegion < _numRegions && _plannedBoundsVersion != UIWidget::_boundsVersion) {
+    _requeuePlanned(); // Widgets have moved since the redraw was planned.
+  }
+
+  if (_curRegion >= _numRegions && !_planRedraw()) {
+    return false;
+  }
+
+  const DamagedRegion &region = _regions[_curRegion];
+  _beginDraw(_curBand, region.covered);
+  if (region.uniformBg) {
+    _fillBackground(_curBand, region.bgColor);
+  }
+
+  for (uint8_t i = 0; i < _numPlanned; i++) {
+    if (_plannedRegion[i] == _curRegion) {
+      if (!region.uniformBg) {
+        _fillBackground(_plannedWidgets[i]->getRect().intersection(_curBand), _plannedBg[i]);
+      }
+      UIWidget *widget = _plannedWidgets[i];
+      widget->redrawChildWidget(widget, _lcd, _plannedFlags[i] | RF_PARENT_BG_DRAWN);
+    }
   }
+  _endDraw();
 
-  _widget->redrawChildWidget(widget, _lcd, renderFlags);
+  _curBand = _nextBand(region.rect, _curBand);
+  if (_curBand.isEmpty()) {
+    _curRegion++; // On to the next region.
+    if (_curRegion < _numRegions) {
+      _curBand = _firstBand(_regions[_curRegion].rect, _regions[_curRegion].covered);
+    } else {
+      _lcd.finishOffscreen(); // Redraw complete.
+    }
+  }
+
+  return true;
 }
 
+/**
+ * Abandon the redraw in progress, returning the widgets not yet completely drawn to the queue so
+ * that the next _planRedraw() works out their regions and backgrounds afresh.
+ */
+void Screen::_requeuePlanned() {
+  uint8_t numPlanned = _numPlanned;
+  uint8_t curRegion = _curRegion;
+  _numPlanned = 0;
+  _numRegions = 0;
+  _curRegion = 0;
+
+  for (uint8_t i = 0; i < numPlanned; i++) {
+    if (_plannedRegion[i] >= curRegion) {
+      invalidate(_plannedWidgets[i], _plannedFlags[i]);
+    }
+  }
+}
+
+/**
+ * Take the widgets queued by invalidate() and plan how to redraw them: coalesce them into damaged
+ * regions and work out what background each one needs. Returns false if nothing needs drawing.
+ */
+bool Screen::_planRedraw() {
+  _numPlanned = 0;
+  _numRegions = 0;
+  _curRegion = 0;
+  _plannedBoundsVersion = UIWidget::_boundsVersion;
+
+  if (NULL == _widget) {
+    _clearDirty();
+    return false;
+  } else if (_fullRedrawPending) {
+    // The queue overflowed; redraw everything.
+    _dirtyWidgets[0] = _widget;
+    _dirtyFlags[0] = RF_NONE;
+    _numDirty = 1;
+  }
+
+  // Work out the topmost opaque background under each widget, and whether it inherits focus
+  // from an ancestor. Widgets that are not currently
+  // visible (e.g., scrolled out of a VScroll) are dropped from the queue; they are not redrawn
+  // and their (stale) bounding boxes must not be filled in either.
+  for (uint8_t i = 0; i < _numDirty; i++) {
+    if (_findBackground(_dirtyWidgets[i], _dirtyFlags[i], _plannedBg[_numPlanned])) {
+      _plannedWidgets[_numPlanned] = _dirtyWidgets[i];
+      _plannedFlags[_numPlanned] = _dirtyFlags[i];
+      _numPlanned++;
+    }
+  }
+  _clearDirty(); // Widgets invalidated from here on are drawn by the next redraw.
+
+  if (0 == _numPlanned) {
+    return false;
+  }
+
+  // Coalesce the planned widgets into damaged regions. Two regions are merged only when their
+  // union is itself exactly a rectangle, so that filling a merged region with background color
+  // never erases pixels of a widget that is not about to be redrawn. Regions are also only
+  // merged if they agree on whether backgrounds are drawn.
+  UIRect rects[SCREEN_MAX_DIRTY_WIDGETS];
+  bool live[SCREEN_MAX_DIRTY_WIDGETS]; // False once a rect has been merged into another.
+
+  for (uint8_t i = 0; i < _numPlanned; i++) {
+    rects[i] = _plannedWidgets[i]->getRect();
+    _plannedRegion[i] = i;
+    live[i] = true;
+  }
+
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (uint8_t a = 0; a < _numPlanned; a++) {
+      for (uint8_t b = a + 1; live[a] && b < _numPlanned; b++) {
+        if (!live[b] || !rects[a].mergesExactlyWith(rects[b])
+            || (_plannedFlags[a] & RF_NO_BACKGROUNDS) != (_plannedFlags[b] & RF_NO_BACKGROUNDS)) {
+          continue;
+        }
+
+        rects[a].unionWith(rects[b]);
+        live[b] = false;
+        for (uint8_t i = 0; i < _numPlanned; i++) {
+          if (_plannedRegion[i] == b) {
+            _plannedRegion[i] = a;
+          }
+        }
+        merged = true;
+      }
+    }
+  }
+
+  // Number the surviving regions consecutively. If every widget in a region sits on the same
+  // background, that is filled once across the whole region; otherwise each widget's own rect is
+  // filled separately.
+  for (uint8_t r = 0; r < _numPlanned; r++) {
+    if (!live[r]) {
+      continue;
+    }
+
+    DamagedRegion &region = _regions[_numRegions];
+    region.rect = rects[r];
+    region.bgColor = _plannedBg[r];
+    region.uniformBg = true;
+    region.covered = true; // True if every pixel of the region is about to be repainted.
+    for (uint8_t i = 0; i < _numPlanned; i++) {
+      if (_plannedRegion[i] != r) {
+        continue;
+      }
+
+      _plannedRegion[i] = _numRegions;
+      if (_plannedBg[i] != region.bgColor) {
+        region.uniformBg = false;
+      }
+
+      if (_plannedBg[i] == TRANSPARENT_COLOR && !_plannedWidgets[i]->isOpaque(_plannedFlags[i])) {
+        region.covered = false;
+      }
+    }
+
+    _numRegions++;
+  }
+
+  _curBand = _firstBand(_regions[0].rect, _regions[0].covered);
+  return true;
+}
+
+/**
+ * Find the innermost (i.e., topmost when drawn) opaque background that lies underneath 'widget'.
+ * Sets 'bgColor' to that color, or to TRANSPARENT_COLOR if nothing needs to be filled in before
+ * 'widget' is redrawn (because backgrounds are suppressed, or 'widget' covers its own bounding
+ * box with its own background). Adds RF_FOCUSED to 'renderFlags' if 'widget' inherits focus from
+ * an ancestor, as it would when the whole screen is rendered.
+ *
+ * This walks up from 'widget' through its parent links, at O(depth) cost. If that does not reach
+ * the top-level widget (e.g., 'widget' is inside a custom container that does not record itself
+ * as its children's parent), this falls back to searching down from the top-level widget.
+ *
+ * Returns false if 'widget' is not a visible descendant of the top-level widget.
+ */
+bool Screen::_findBackground(UIWidget *widget, uint32_t &renderFlags, uint16_t &bgColor) const {
+  UIWidget *bgOwner = NULL; // Innermost ancestor with a background for its children.
+  bool bgFocused = false; // True if bgOwner or an ancestor of it is focused.
+  bool focused = false; // True if any ancestor is focused.
+
+  UIWidget *cur = widget;
+  while (cur != _widget) {
+    cur = cur->getParent();
+    if (NULL == cur) {
+      break; // No parent link to follow.
+    }
+
+    if (NULL == bgOwner && cur->getChildBackground(RF_NONE) != TRANSPARENT_COLOR) {
+      bgOwner = cur;
+    }
+
+    if (cur->isFocused()) {
+      focused = true;
+      bgFocused = bgFocused || NULL != bgOwner;
+    }
+  }
+
+  if (NULL == cur && !_searchBackground(widget, bgOwner, bgFocused, focused)) {
+    return false;
+  }
+
+  uint32_t bgFlags = bgFocused ? (renderFlags | RF_FOCUSED) : renderFlags;
+  bgColor = (NULL == bgOwner) ? _bgColor : bgOwner->getChildBackground(bgFlags);
+  if (focused) {
+    renderFlags |= RF_FOCUSED;
+  }
+
+  if ((renderFlags & RF_NO_BACKGROUNDS) == RF_NO_BACKGROUNDS || widget->isOpaque(renderFlags)) {
+    bgColor = TRANSPARENT_COLOR;
+  }
+
+  return true;
+}
+
+/**
+ * Fallback for _findBackground(): walk down from the top-level widget to 'widget', finding the
+ * same ancestors with getChildContaining(). Returns false if 'widget' is not a visible descendant.
+ */
+bool Screen::_searchBackground(UIWidget *widget, UIWidget *&bgOwner, bool &bgFocused,
+    bool &focused) const {
+  bgOwner = NULL;
+  bgFocused = false;
+  focused = false;
+  if (!_widget->containsWidget(widget)) {
+    return false;
+  }
+
+  UIWidget *cur = _widget;
+  while (cur != widget) {
+    focused = focused || cur->isFocused();
+    if (cur->getChildBackground(RF_NONE) != TRANSPARENT_COLOR) {
+      bgOwner = cur;
+      bgFocused = focused;
+    }
+
+    cur = cur->getChildContaining(widget);
+    if (NULL == cur) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+void Screen::_fillBackground(const UIRect &area, uint16_t bgColor) {
+  if (bgColor != TRANSPARENT_COLOR && !area.isEmpty()) {
+    UIWidget::fillBackgroundRect(_lcd, area.x, area.y, area.w, area.h, bgColor);
+  }
+}
+
+/**
+ * Return the first band of 'area' to draw. When rendering off-screen with a band height set,
+ * this is the top _bandHeight lines of 'area'; otherwise 'area' is drawn in one pass.
+ */
+UIRect Screen::_firstBand(const UIRect &area, bool covered) const {
+  UIRect band = area;
+  if (_offscreen && covered && _bandHeight > 0) {
+    band.h = min(area.h, _bandHeight);
+  }
+
+  return band;
+}
+
+// Return the band of 'area' below 'band', or an empty rect if 'band' was the last one.
+UIRect Screen::_nextBand(const UIRect &area, const UIRect &band) const {
+  UIRect next = band;
+  next.y = band.y + band.h;
+  next.h = min(band.h, area.y + area.h - next.y);
+  return next;
+}
+
+/**
+ * Prepare to draw 'area'. Drawing is clipped to 'area' until _endDraw(), and containers skip
+ * children outside of it. In off-screen mode, drawing is also redirected into a buffer covering
+ * 'area' until _endDraw(); otherwise (or if the DrawTarget cannot allocate the buffer) drawing
+ * goes directly to the display.
+ *
+ * The buffer replaces every pixel of 'area' when pushed (and may hold a prior band's content), so
+ * it is only used if the caller is about to repaint all of 'area' ('covered' is true).
+ *
+ * The buffer is reused from one band and redraw to the next; call _lcd.finishOffscreen() once the
+ * last band of a redraw has been drawn.
+ */
+void Screen::_beginDraw(const UIRect &area, bool covered) {
+  _drawingOffscreen = _offscreen && covered && _lcd.beginOffscreen(area);
+  _lcd.setClipRect(area);
+}
+
+// Remove the clip rect and, if drawing off-screen, push the buffer to the display in a single
+// windowed write.
+void Screen::_endDraw() {
+  _lcd.clearClipRect();
+  if (_drawingOffscreen) {
+    _lcd.endOffscreen();
+    _drawingOffscreen = false;
+  }
+}
+
+#ifdef UIW_ENABLE_STATS
+// Start a new frame: widgets drawn from here on reset their stats before recording new ones.
+void Screen::_beginFrame() {
+  uiwStatsTotals.frame++;
+  _frameStart = uiwStatsTotals;
+}
+
+// Record everything counted since _beginFrame() as the stats for this frame.
+void Screen::_endFrame() {
+  _lastFrameStats.frame = uiwStatsTotals.frame;
+  _lastFrameStats.drawCalls = uiwStatsTotals.drawCalls - _frameStart.drawCalls;
+  _lastFrameStats.pixels = uiwStatsTotals.pixels - _frameStart.pixels;
+  _lastFrameStats.glyphs = uiwStatsTotals.glyphs - _frameStart.glyphs;
+  for (uint8_t i = 0; i < STATS_NUM_TIMERS; i++) {
+    _lastFrameStats.micros[i] = uiwStatsTotals.micros[i] - _frameStart.micros[i];
+  }
+}
+#endif // UIW_ENABLE_STATS
+
 void Screen::setWidget(UIWidget *w) {
   _widget = w;
+  _discardRedraws();
   if (NULL != _widget) {
-    _widget->setBoundingBox(0, 0, getWidth(), getHeight());
+    _layout();
   }
 }
 
+void Screen::updateLayout() {
+  if (NULL != _widget && _layoutVersion != UIWidget::_layoutVersion) {
+    _layout();
+  }
+}
+
+UIWidget *Screen::widgetAt(int16_t x, int16_t y) {
+  if (NULL == _widget) {
+    return NULL;
+  }
+
+  updateLayout();
+  return _widget->widgetAt(x, y);
+}
+
+// Lay out the entire widget tree in one pass from the top, however many widgets changed. FLEX
+// elements are measured with this Screen's DrawTarget (which also remains in use for layouts
+// done outside of a pass, e.g. when a VScroll scrolls).
+void Screen::_layout() {
+  _layoutVersion = UIWidget::_layoutVersion;
+  UIWidget::_layoutTarget = &_lcd;
+  _widget->setBoundingBox(0, 0, getWidth(), getHeight());
+}
+
@@ -9,9 +9,18 @@ constexpr uint32_t RF_NONE              =     0x0;
 constexpr uint32_t RF_NO_BACKGROUNDS    =     0x1; // Ignore underlying background fields.
 constexpr uint32_t RF_FOCUSED           =     0x2; // Current element has focus even if isFocused()
                                                    // returns false.
+constexpr uint32_t RF_PARENT_BG_DRAWN   =     0x4; // The Screen already filled the background
+                                                   // under the redrawn widget; containers must
+                                                   // not fill it again on the way down.
 
 constexpr uint32_t RF_WIDGET_SPECIFIC   =  0x1000; // Indicates widget-specific interpretations
                                                    // for flags masked by FFFF0000.
+// Bits of a render flags word that carry widget-specific meaning (see RF_WIDGET_SPECIFIC).
+constexpr uint32_t RF_WIDGET_SPECIFIC_MASK = 0xFFFF0000 | RF_WIDGET_SPECIFIC;
+
+// Max number of widgets that can be queued with Screen::invalidate() before the queue
+// overflows and the next flush() falls back to redrawing the entire screen.
+constexpr uint8_t SCREEN_MAX_DIRTY_WIDGETS = 16;
 
 /**
  * A Screen is the top-level UIWidgets container. This is not itself a UIWidget;
@@ -22,28 +31,151 @@ constexpr uint32_t RF_WIDGET_SPECIFIC   =  0x1000; // Indicates widget-specific
  */
 class Screen {
 public:
-  Screen(TFT_eSPI &lcd): _lcd(lcd), _widget(NULL), _bgColor(TFT_BLACK) {};
+  // Draw on a TFT_eSPI display. Allocates a TftDrawTarget on the heap, once, freed by ~Screen();
+  // to avoid that, declare a TftDrawTarget yourself and pass it to Screen(DrawTarget&).
+  Screen(TFT_eSPI &lcd);
+  // Draw on an arbitrary DrawTarget, such as a CanvasDrawTarget.
+  Screen(DrawTarget &target);
+  ~Screen();
+
+  DrawTarget &getDrawTarget() { return _lcd; };
 
   void setWidget(UIWidget *w);
   UIWidget *getWidget() const { return _widget; };
 
+  // Lay out the widget tree again if any widget has called invalidateLayout() since the last
+  // layout pass. This is done automatically before drawing and before invalidate(); call it
+  // yourself only to read up-to-date widget positions.
+  void updateLayout();
+
   // Render the entire screen.
   void render(uint32_t renderFlags = RF_NONE);
+  // Repaint just 'area' of the screen: fill it with the screen background and render every widget
+  // that overlaps it, clipped to 'area'. Widgets entirely outside 'area' are skipped. Unlike
+  // render(), this does not cancel redraws queued by invalidate().
+  void renderRect(const UIRect &area, uint32_t renderFlags = RF_NONE);
+
+  // Return the innermost visible widget at screen pixel (x, y), e.g. to find the widget under a
+  // touch; or NULL if there is no widget there. Lays out the screen first if needed.
+  UIWidget *widgetAt(int16_t x, int16_t y);
 
   // Re-render one widget whose view is invalidated (along with any backgrounds, etc.
   // underneath it).
   void renderWidget(UIWidget *widget, uint32_t renderFlags=0);
 
+  // Mark a widget as needing to be redrawn at the next flush(), rather than redrawing it
+  // immediately like renderWidget() does.
+  void invalidate(UIWidget *widget, uint32_t renderFlags=RF_NONE);
+  // Redraw all widgets invalidated since the last flush(). Invalidated widgets whose areas
+  // overlap or abut are merged into a single damaged region that is repainted once.
+  void flush();
+  // Spend up to 'budgetMicros' microseconds redrawing invalidated widgets, and return true if
+  // there is more to draw. Work is done one damaged region (or, if a band height is set, one band
+  // of a region) at a time, so a tick may overrun its budget by up to one such step; work left
+  // over when the budget runs out resumes at the next tick() or flush().
+  bool tick(uint32_t budgetMicros);
+  // Return true if invalidate() has queued work for the next flush() or tick().
+  bool hasPendingRedraw() const {
+    return _fullRedrawPending || _numDirty > 0 || _curRegion < _numRegions;
+  };
+
   int16_t getWidth() const { return _lcd.width(); };
   int16_t getHeight() const { return _lcd.height(); };
 
   void setBackground(uint16_t bgColor) { _bgColor = bgColor; };
 
+  // If enabled, render(), renderRect(), renderWidget(), and flush() draw into an off-screen
+  // buffer covering just the area being redrawn, and push it to the display in a single write.
+  // (Requires a DrawTarget that supports off-screen drawing; TftDrawTarget uses a TFT_eSprite.)
+  // The buffer is kept from one redraw to the next; disabling this frees it.
+  void setOffscreenRendering(bool enable);
+  bool isOffscreenRendering() const { return _offscreen; };
+  // If > 0, off-screen rendering draws and pushes each area in horizontal bands of this many
+  // lines, so the buffer needs only (width * lines * 2) bytes. 0 draws each area in one pass.
+  // Frees the buffer, to be allocated afresh for the new bands at the next redraw.
+  void setBandHeight(int16_t lines);
+  int16_t getBandHeight() const { return _bandHeight; };
+
+  // Return the number of pixels filled with background color by the most recent render(),
+  // renderRect(), renderWidget(), flush(), or tick().
+  uint32_t getLastRedrawBackgroundPixels() const { return _lastBgPixels; };
+
+#ifdef UIW_ENABLE_STATS
+  // Return the draw calls, pixels, glyphs, and time spent in render(), cascadeBoundingBox(), and
+  // redrawChildWidget() during the most recent render(), renderRect(), renderWidget(), flush(), or
+  // tick().
+  const RenderStats &getLastFrameStats() const { return _lastFrameStats; };
+#endif
+
 private:
-  TFT_eSPI &_lcd;
+  bool _findBackground(UIWidget *widget, uint32_t &renderFlags, uint16_t &bgColor) const;
+  bool _searchBackground(UIWidget *widget, UIWidget *&bgOwner, bool &bgFocused,
+      bool &focused) const;
+  void _fillBackground(const UIRect &area, uint16_t bgColor);
+  UIRect _firstBand(const UIRect &area, bool covered) const;
+  UIRect _nextBand(const UIRect &area, const UIRect &band) const;
+  void _beginDraw(const UIRect &area, bool covered);
+  void _endDraw();
+  void _layout();
+  bool _planRedraw();
+  bool _redrawStep();
+  void _requeuePlanned();
+  void _clearDirty() { _numDirty = 0; _fullRedrawPending = false; };
+  // Drop all queued and in-progress redraws.
+  void _discardRedraws() { _clearDirty(); _numPlanned = 0; _numRegions = 0; _curRegion = 0; };
+#ifdef UIW_ENABLE_STATS
+  void _beginFrame();
+  void _endFrame();
+#else
+  void _beginFrame() { };
+  void _endFrame() { };
+#endif
+
+  // Owned adapter if constructed for a TFT_eSPI; otherwise NULL. Held by pointer, since it
+  // contains two sprites that a Screen built on another DrawTarget would not use.
+  TftDrawTarget *_tftTarget;
+#ifdef UIW_ENABLE_STATS
+  StatsDrawTarget _statsTarget; // Counts everything drawn before forwarding it to the display.
+  RenderStats _frameStart; // uiwStatsTotals as of _beginFrame().
+  RenderStats _lastFrameStats;
+#endif
+  DrawTarget &_lcd;
+  bool _offscreen;
+  bool _drawingOffscreen; // True between _beginDraw() and _endDraw() if drawing off-screen.
+  int16_t _bandHeight;
+
   UIWidget *_widget; // The top-most widget for rendering the screen.
+  uint32_t _layoutVersion; // UIWidget::_layoutVersion as of the last layout pass.
 
   uint16_t _bgColor;
+  uint32_t _lastBgPixels;
+
+  // Queue of widgets (and the render flags to redraw them with) awaiting flush().
+  UIWidget *_dirtyWidgets[SCREEN_MAX_DIRTY_WIDGETS];
+  uint32_t _dirtyFlags[SCREEN_MAX_DIRTY_WIDGETS];
+  uint8_t _numDirty;
+  bool _fullRedrawPending; // Set if the queue overflowed; flush() redraws everything.
+
+  // A damaged area of the screen, covering one or more invalidated widgets.
+  struct DamagedRegion {
+    UIRect rect;
+    uint16_t bgColor; // Background to fill across 'rect', if uniformBg.
+    bool uniformBg; // True if all widgets in the region share one background.
+    bool covered; // True if every pixel of 'rect' is repainted.
+  };
+
+  // The redraw in progress: widgets taken from the queue by _planRedraw(), the region each one
+  // belongs to and the background underneath it, and how far _redrawStep() has got.
+  UIWidget *_plannedWidgets[SCREEN_MAX_DIRTY_WIDGETS];
+  uint32_t _plannedFlags[SCREEN_MAX_DIRTY_WIDGETS];
+  uint16_t _plannedBg[SCREEN_MAX_DIRTY_WIDGETS];
+  uint8_t _plannedRegion[SCREEN_MAX_DIRTY_WIDGETS];
+  uint8_t _numPlanned;
+  uint32_t _plannedBoundsVersion; // UIWidget::_boundsVersion as of _planRedraw().
+  DamagedRegion _regions[SCREEN_MAX_DIRTY_WIDGETS];
+  uint8_t _numRegions;
+  uint8_t _curRegion; // Region being drawn; the redraw is complete when this == _numRegions.
+  UIRect _curBand; // Next band of _regions[_curRegion] to draw.
 };
 
 
@@ -0,0 +1,89 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+void StaticLayout::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
+  drawBackground(lcd, renderFlags);
+  drawBorder(lcd, renderFlags);
+
+  if (isFocused(renderFlags)) {
+    renderFlags |= RF_FOCUSED; // propagate our focused nature to any child element(s).
+  }
+
+  for (uint16_t i = 0; i < _count; i++) {
+    UIWidget *widget = _children[i];
+    if (widget != NULL && lcd.intersectsClip(widget->getRect())) {
+      widget->render(lcd, renderFlags); // Skip children entirely outside the clip rect.
+    }
+  }
+}
+
+void StaticLayout::cascadeBoundingBox() {
+  UIW_STATS_SCOPE(_stats, STATS_LAYOUT);
+  for (uint16_t i = 0; i < _count; i++) {
+    UIWidget *widget = _children[i];
+    if (widget != NULL) {
+      const UIRect &r = _rects[i];
+      setChildBoundingBox(widget, _x + r.x, _y + r.y, r.w, r.h);
+    }
+  }
+}
+
+int16_t StaticLayout::getContentWidth(DrawTarget &lcd) const {
+  // Wide enough to reach the right edge of the right-most rect.
+  int16_t w = 0;
+  for (uint16_t i = 0; i < _count; i++) {
+    w = max(w, (int16_t)(_rects[i].x + _rects[i].w));
+  }
+
+  return w;
+}
+
+int16_t StaticLayout::getContentHeight(DrawTarget &lcd) const {
+  // Tall enough to reach the bottom edge of the lowest rect.
+  int16_t h = 0;
+  for (uint16_t i = 0; i < _count; i++) {
+    h = max(h, (int16_t)(_rects[i].y + _rects[i].h));
+  }
+
+  return h;
+}
+
+bool StaticLayout::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
+  if (NULL == widget) {
+    return false;
+  } else if (this == widget) {
+    render(lcd, renderFlags);
+    return true;
+  }
+
+  UIWidget *child = getChildContaining(widget);
+  if (child != NULL) {
+    drawBackgroundUnderWidget(widget, lcd, renderFlags);
+    return child->redrawChildWidget(widget, lcd, renderFlags);
+  }
+
+  return false;
+}
+
+UIWidget *StaticLayout::getChildContaining(UIWidget *widget) const {
+  for (uint16_t i = 0; i < _count; i++) {
+    if (_children[i] != NULL && _children[i]->containsWidget(widget)) {
+      return _children[i];
+    }
+  }
+
+  return NULL;
+}
+
+UIWidget *StaticLayout::getChildAt(int16_t x, int16_t y) const {
+  for (uint16_t i = 0; i < _count; i++) {
+    if (_children[i] != NULL && _children[i]->containsPoint(x, y)) {
+      return _children[i];
+    }
+  }
+
+  return NULL;
+}
@@ -0,0 +1,106 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_STATIC_LAYOUT_H
+#define __UIW_STATIC_LAYOUT_H
+
+/*
+ * Compile-time layout. For a screen whose geometry is fixed, the rect of each widget can be
+ * computed by constexpr evaluation with the functions below, which split an area the same way
+ * Rows and Cols do, and the results placed in a const array (in flash) for a StaticLayout to
+ * apply. e.g.:
+ *
+ *   constexpr UIRect SCREEN_RECT = { 0, 0, 320, 240 };
+ *   constexpr int16_t MAIN_ROWS[] = { 24, EQUAL, 32 };
+ *   constexpr int16_t BODY_COLS[] = { EQUAL, 100 };
+ *   constexpr UIRect BODY_RECT = layoutRow(SCREEN_RECT, MAIN_ROWS, 3, 1);
+ *   constexpr UIRect RECTS[] = {
+ *     layoutRow(SCREEN_RECT, MAIN_ROWS, 3, 0),  // title
+ *     layoutCol(BODY_RECT, BODY_COLS, 2, 0),    // list
+ *     layoutCol(BODY_RECT, BODY_COLS, 2, 1),    // details
+ *     layoutRow(SCREEN_RECT, MAIN_ROWS, 3, 2),  // status line
+ *   };
+ *
+ * FLEX sizes depend on text measured at runtime, so they are treated as EQUAL here.
+ */
+
+// Total of the fixed sizes among the first 'n' entries of 'sizes'.
+constexpr int32_t layoutClaimedSize(const int16_t *sizes, uint16_t n) {
+  return n == 0 ? 0 : (sizes[n - 1] >= 0 ? sizes[n - 1] : 0) + layoutClaimedSize(sizes, n - 1);
+}
+
+// Number of EQUAL (or FLEX) entries among the first 'n' entries of 'sizes'.
+constexpr uint16_t layoutEqualCount(const int16_t *sizes, uint16_t n) {
+  return n == 0 ? 0 : (sizes[n - 1] < 0 ? 1 : 0) + layoutEqualCount(sizes, n - 1);
+}
+
+// Size given to each EQUAL entry when the 'n' entries of 'sizes' share 'available' pixels.
+constexpr int16_t layoutEqualSize(const int16_t *sizes, uint16_t n, int16_t available) {
+  return (available > layoutClaimedSize(sizes, n) ? available - layoutClaimedSize(sizes, n) : 0)
+      / (layoutEqualCount(sizes, n) > 0 ? layoutEqualCount(sizes, n) : 1);
+}
+
+// Size given to entry 'i' of the 'n' entries of 'sizes' sharing 'available' pixels.
+constexpr int16_t layoutSize(const int16_t *sizes, uint16_t n, int16_t available, uint16_t i) {
+  return sizes[i] < 0 ? layoutEqualSize(sizes, n, available)
+      : (sizes[i] < available ? sizes[i] : available);
+}
+
+// Offset of entry 'i' from the start of the 'n' entries of 'sizes' sharing 'available' pixels.
+constexpr int16_t layoutOffset(const int16_t *sizes, uint16_t n, int16_t available, uint16_t i) {
+  return i == 0 ? 0
+      : layoutOffset(sizes, n, available, i - 1) + layoutSize(sizes, n, available, i - 1);
+}
+
+// Return the rect of row 'i' when 'area' is split into 'n' rows of the given heights, as a Rows
+// with no border or padding would do.
+constexpr UIRect layoutRow(const UIRect &area, const int16_t *heights, uint16_t n, uint16_t i) {
+  return UIRect{ area.x, (int16_t)(area.y + layoutOffset(heights, n, area.h, i)), area.w,
+      layoutSize(heights, n, area.h, i) };
+}
+
+// Return the rect of column 'i' when 'area' is split into 'n' columns of the given widths, as a
+// Cols with no border or padding would do.
+constexpr UIRect layoutCol(const UIRect &area, const int16_t *widths, uint16_t n, uint16_t i) {
+  return UIRect{ (int16_t)(area.x + layoutOffset(widths, n, area.w, i)), area.y,
+      layoutSize(widths, n, area.w, i), area.h };
+}
+
+// Return 'area' shrunk by the given margins on each side, e.g. to leave room for a border.
+constexpr UIRect layoutInset(const UIRect &area, int16_t left, int16_t right, int16_t top,
+    int16_t bottom) {
+  return UIRect{ (int16_t)(area.x + left), (int16_t)(area.y + top),
+      (int16_t)(area.w - left - right), (int16_t)(area.h - top - bottom) };
+}
+
+/**
+ * A container that places each of its children at a rect fixed ahead of time (e.g., computed at
+ * compile time with layoutRow() and layoutCol()), relative to its own top-left corner. Laying it
+ * out just moves each child to its rect; no sizes are computed at runtime. Both arrays are
+ * referenced rather than copied, so they can be declared const (and kept in flash).
+ *
+ * The rects ignore any border or padding on the StaticLayout itself.
+ */
+class StaticLayout: public UIWidget {
+public:
+  StaticLayout(UIWidget *const *children, const UIRect *rects, uint16_t count):
+      UIWidget(), _children(children), _rects(rects), _count(count) {};
+
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
+  virtual void cascadeBoundingBox();
+
+  uint16_t getNumChildren() const { return _count; };
+
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
+
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+  virtual UIWidget *getChildContaining(UIWidget *widget) const;
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const;
+
+private:
+  UIWidget *const *_children; // one for each rect; may contain NULLs.
+  const UIRect *_rects;
+  uint16_t _count;
+};
+
+#endif // __UIW_STATIC_LAYOUT_H
@@ -0,0 +1,242 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+void TftDrawTarget::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (clipToRect(x, y, w, h)) {
+    _drawTo()->fillRect(x - _area.x, y - _area.y, w, h, color);
+  }
+}
+
+void TftDrawTarget::drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (!_clipped) {
+    _drawTo()->drawRect(x - _area.x, y - _area.y, w, h, color);
+    return;
+  }
+
+  // Draw each edge separately, so that each is clipped.
+  drawFastHLine(x, y, w, color);
+  drawFastHLine(x, y + h - 1, w, color);
+  drawFastVLine(x, y, h, color);
+  drawFastVLine(x + w - 1, y, h, color);
+}
+
+void TftDrawTarget::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  int16_t h = 1;
+  if (clipToRect(x, y, w, h)) {
+    _drawTo()->drawFastHLine(x - _area.x, y - _area.y, w, color);
+  }
+}
+
+void TftDrawTarget::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  int16_t w = 1;
+  if (clipToRect(x, y, w, h)) {
+    _drawTo()->drawFastVLine(x - _area.x, y - _area.y, h, color);
+  }
+}
+
+void TftDrawTarget::drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  UIRect bounds = { x, y, w, h };
+  if (intersectsClip(bounds)) {
+    _drawTo()->drawRoundRect(x - _area.x, y - _area.y, w, h, r, color);
+  }
+}
+
+void TftDrawTarget::fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+    uint16_t color) {
+  UIRect bounds = { x, y, w, h };
+  if (!_clipped || _clip.contains(bounds)) {
+    _drawTo()->fillRoundRect(x - _area.x, y - _area.y, w, h, r, color);
+  } else if (_clip.intersects(bounds)) {
+    // Fills are clipped exactly, so that partial repaints leave the rest of the widget intact.
+    fillRoundRectSpans(x, y, w, h, r, color);
+  }
+}
+
+void TftDrawTarget::drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  if (!_boundsClipped(x0, y0, x1, y1, x2, y2)) {
+    _drawTo()->drawTriangle(x0 - _area.x, y0 - _area.y, x1 - _area.x, y1 - _area.y,
+        x2 - _area.x, y2 - _area.y, color);
+  }
+}
+
+void TftDrawTarget::fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2, uint16_t color) {
+  if (!_boundsClipped(x0, y0, x1, y1, x2, y2)) {
+    _drawTo()->fillTriangle(x0 - _area.x, y0 - _area.y, x1 - _area.x, y1 - _area.y,
+        x2 - _area.x, y2 - _area.y, color);
+  }
+}
+
+void TftDrawTarget::pushImage(int16_t x, int16_t y, int16_t w, int16_t h,
+    const uint16_t *pixels) {
+  int16_t cx = x, cy = y, cw = w, ch = h;
+  if (!clipToRect(cx, cy, cw, ch)) {
+    return;
+  } else if (cw == w && ch == h) {
+    _drawTo()->pushImage(x - _area.x, y - _area.y, w, h, (uint16_t*)pixels);
+    return;
+  }
+
+  // Push the visible part one row at a time.
+  TFT_eSPI *draw = _drawTo();
+  for (int16_t row = cy; row < cy + ch; row++) {
+    draw->pushImage(cx - _area.x, row - _area.y, cw, 1,
+        (uint16_t*)pixels + (int32_t)(row - y) * w + (cx - x));
+  }
+}
+
+bool TftDrawTarget::copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX,
+    int16_t dstY) {
+  UIRect src = { x, y, w, h };
+  UIRect dst = { dstX, dstY, w, h };
+  if (_draw != &_lcd || (_clipped && (!_clip.contains(src) || !_clip.contains(dst)))) {
+    return false; // Drawing into a sprite, or the block is not entirely within the clip rect.
+  }
+
+  // Read rows back from the display and write them at their destination, as many whole rows at a
+  // time as fit in the buffer, in an order that reads each one before it is overwritten. Rows
+  // wider than the buffer are moved a piece at a time, right to left when the block moves right
+  // along its own rows. readRect() returns pixels as pushImage() sends them with byte swapping
+  // off, so that is turned off meanwhile, whatever the sketch set with setSwapBytes().
+  uint16_t buf[TFT_COPY_BUF_PIXELS];
+  TFT_eSPI *draw = _drawTo();
+  int16_t rowsPerCopy = max((int16_t)1, (int16_t)(TFT_COPY_BUF_PIXELS / w));
+  int16_t pieceW = min(w, TFT_COPY_BUF_PIXELS);
+  int16_t numPieces = (w + pieceW - 1) / pieceW;
+  bool rightToLeft = dstY == y && dstX > x;
+  bool swapBytes = draw->getSwapBytes();
+  draw->setSwapBytes(false);
+  for (int16_t done = 0; done < h; ) {
+    int16_t n = min(rowsPerCopy, (int16_t)(h - done));
+    int16_t row = dstY > y ? h - done - n : done;
+    for (int16_t p = 0; p < numPieces; p++) {
+      int16_t col = (rightToLeft ? numPieces - 1 - p : p) * pieceW;
+      int16_t cw = min((int16_t)(w - col), pieceW);
+      draw->readRect(x + col, y + row, cw, n, buf);
+      draw->pushImage(dstX + col, dstY + row, cw, n, buf);
+    }
+    done += n;
+  }
+  draw->setSwapBytes(swapBytes);
+
+  return true;
+}
+
+// Return true if text drawn at (x, y) in the current font lies entirely outside the clip rect.
+// Only its left edge and height are checked, to avoid measuring it.
+bool TftDrawTarget::_textClipped(int16_t x, int16_t y) {
+  return _clipped && (x >= _clip.x + _clip.w || y >= _clip.y + _clip.h
+      || y + _lcd.fontHeight(_fontId) <= _clip.y);
+}
+
+// Return true if the bounding box of the three points lies entirely outside the clip rect.
+bool TftDrawTarget::_boundsClipped(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2,
+    int16_t y2) {
+  if (!_clipped) {
+    return false;
+  }
+
+  int16_t left = min(x0, min(x1, x2));
+  int16_t top = min(y0, min(y1, y2));
+  UIRect bounds = { left, top, (int16_t)(max(x0, max(x1, x2)) - left + 1),
+      (int16_t)(max(y0, max(y1, y2)) - top + 1) };
+  return !_clip.intersects(bounds);
+}
+
+bool TftDrawTarget::beginOffscreen(const UIRect &area) {
+  if (area.isEmpty()) {
+    return false;
+  }
+
+  // Only the other sprite can still be in flight, so this one is free to draw into (or grow). It
+  // is kept from one band and redraw to the next, and only reallocated if 'area' does not fit.
+  TFT_eSprite &sprite = _sprite(_cur);
+  if (!sprite.created() || area.w > _spriteW[_cur] || area.h > _spriteH[_cur]) {
+    int16_t w = max(area.w, _spriteW[_cur]);
+    int16_t h = max(area.h, _spriteH[_cur]);
+    sprite.deleteSprite();
+    if (NULL == sprite.createSprite(w, h)) {
+      // No room for the largest area so far; try for just this one.
+      w = area.w;
+      h = area.h;
+      if (NULL == sprite.createSprite(w, h)) {
+        _spriteW[_cur] = 0;
+        _spriteH[_cur] = 0;
+        return false; // Out of memory.
+      }
+    }
+    _spriteW[_cur] = w;
+    _spriteH[_cur] = h;
+  }
+
+  // Draw into the sprite, shifting coordinates so that 'area' lands at its origin. The sprite
+  // clips anything drawn outside of its bounds; anything drawn within them but outside of 'area'
+  // is not pushed.
+  _draw = &sprite;
+  _area = area;
+  return true;
+}
+
+void TftDrawTarget::endOffscreen() {
+  if (_draw == &_lcd) {
+    return; // Not drawing off-screen.
+  }
+
+  // If the sprite is wider than the area, pack the area's rows together to push them as one block.
+  uint16_t *pixels = (uint16_t*)_sprite(_cur).getPointer();
+  int16_t stride = _spriteW[_cur];
+  if (_area.w < stride) {
+    for (int16_t row = 1; row < _area.h; row++) {
+      memmove(pixels + (int32_t)row * _area.w, pixels + (int32_t)row * stride,
+          _area.w * sizeof(uint16_t));
+    }
+  }
+
+  if (NULL == _transport) {
+    // Sprite pixels are already in the display's byte order, as pushSprite() assumes.
+    bool swapBytes = _lcd.getSwapBytes();
+    _lcd.setSwapBytes(false);
+    _lcd.pushImage(_area.x, _area.y, _area.w, _area.h, pixels);
+    _lcd.setSwapBytes(swapBytes);
+  } else {
+    // Start pushing this sprite, and draw the next area into the other one in the meantime.
+    _transport->startPush(_area.x, _area.y, _area.w, _area.h, pixels);
+    _pushPending = true;
+    _cur ^= 1;
+  }
+
+  _draw = &_lcd;
+  _area.x = 0;
+  _area.y = 0;
+}
+
+void TftDrawTarget::finishOffscreen() {
+  _draw = &_lcd;
+  _area.x = 0;
+  _area.y = 0;
+  _finishPush();
+}
+
+void TftDrawTarget::releaseOffscreen() {
+  finishOffscreen();
+  _cur = 0;
+
+  for (uint8_t i = 0; i < 2; i++) {
+    if (_sprite(i).created()) {
+      _sprite(i).deleteSprite();
+    }
+    _spriteW[i] = 0;
+    _spriteH[i] = 0;
+  }
+}
+
+// Wait for the transport to finish pushing sprites.
+void TftDrawTarget::_finishPush() {
+  if (_pushPending) {
+    _transport->waitIdle();
+    _pushPending = false;
+  }
+}
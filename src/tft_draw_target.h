@@ -0,0 +1,123 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_TFT_DRAW_TARGET_H
+#define __UIW_TFT_DRAW_TARGET_H
+
+// Number of pixels copyRect() moves per read and write: as many whole rows as fit, or a piece of a
+// wider row. The buffer (2 KB) is on the stack.
+constexpr int16_t TFT_COPY_BUF_PIXELS = 1024;
+
+/**
+ * A DrawTarget that draws on a TFT_eSPI display.
+ *
+ * Off-screen drawing uses a TFT_eSprite large enough for the off-screen area, which is pushed to
+ * the display with a single windowed write. The sprite is kept until releaseOffscreen(), and only
+ * reallocated (to the largest width and height asked for so far) when an area does not fit.
+ *
+ * Fills, lines, and images are clipped to the clip rect in software; since TFT_eSPI's viewport
+ * support is not available in every port of it, other primitives are only culled (see
+ * DrawTarget::setClipRect()).
+ *
+ * copyRect() reads pixels back from the display with readRect(), so it needs a display whose
+ * MISO line is connected. It moves several rows per transaction, but still reads and rewrites
+ * every pixel, and reading back is slower than writing on most panels: so it is usually cheaper to
+ * draw plain content again than to move it. isCopyCheap() returns false unless setCopyCheap(true)
+ * is called, e.g. for a display with fast readback showing rows that are slow to draw.
+ *
+ * If given a PixelTransport, sprites are pushed through it instead, and two sprites are used in
+ * turn: while one is being transferred (e.g., by DMA), the next band is drawn into the other.
+ */
+class TftDrawTarget : public DrawTarget {
+public:
+  TftDrawTarget(TFT_eSPI &lcd, PixelTransport *transport=NULL): DrawTarget(), _lcd(lcd),
+      _transport(transport), _sprite0(&lcd), _sprite1(&lcd), _draw(&lcd), _cur(0),
+      _pushPending(false), _copyCheap(false), _fontId(1) {
+    _area.x = 0;
+    _area.y = 0;
+    _area.w = 0;
+    _area.h = 0;
+    _spriteW[0] = _spriteW[1] = 0;
+    _spriteH[0] = _spriteH[1] = 0;
+  };
+
+  virtual ~TftDrawTarget() { releaseOffscreen(); };
+
+  TFT_eSPI &getLcd() { return _lcd; };
+  PixelTransport *getTransport() const { return _transport; };
+  // Set whether widgets should prefer copyRect() over drawing again (see isCopyCheap()).
+  void setCopyCheap(bool cheap) { _copyCheap = cheap; };
+
+  virtual int16_t width() { return _lcd.width(); };
+  virtual int16_t height() { return _lcd.height(); };
+
+  virtual void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  virtual void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color);
+  virtual void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color);
+  virtual void drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t r,
+      uint16_t color);
+  virtual void drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+  virtual void fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2,
+      uint16_t color);
+
+  virtual void pushImage(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *pixels);
+  virtual bool copyRect(int16_t x, int16_t y, int16_t w, int16_t h, int16_t dstX, int16_t dstY);
+  virtual bool isCopyCheap() { return _copyCheap; };
+
+  virtual void setTextFont(uint8_t fontId) { _fontId = fontId; _draw->setTextFont(fontId); };
+  virtual void setTextColor(uint16_t fgColor) { _draw->setTextColor(fgColor); };
+  virtual void setTextColor(uint16_t fgColor, uint16_t bgColor) {
+    _draw->setTextColor(fgColor, bgColor);
+  };
+
+  // Text is skipped (returning 0) if it lies entirely outside the clip rect.
+  virtual int16_t drawString(const char *str, int16_t x, int16_t y) {
+    return _textClipped(x, y) ? 0 : _drawTo()->drawString(str, x - _area.x, y - _area.y);
+  };
+  virtual int16_t drawNumber(long val, int16_t x, int16_t y) {
+    return _textClipped(x, y) ? 0 : _drawTo()->drawNumber(val, x - _area.x, y - _area.y);
+  };
+  virtual int16_t drawFloat(float val, uint8_t decimalDigits, int16_t x, int16_t y) {
+    return _textClipped(x, y) ? 0
+        : _drawTo()->drawFloat(val, decimalDigits, x - _area.x, y - _area.y);
+  };
+
+  virtual int16_t textWidth(const char *str, uint8_t fontId) { return _lcd.textWidth(str, fontId); };
+  virtual int16_t fontHeight(uint8_t fontId) { return _lcd.fontHeight(fontId); };
+
+  virtual bool beginOffscreen(const UIRect &area);
+  virtual void endOffscreen();
+  virtual void finishOffscreen();
+  virtual void releaseOffscreen();
+
+private:
+  TFT_eSprite &_sprite(uint8_t i) { return i == 0 ? _sprite0 : _sprite1; };
+  // Return where to draw. Drawing directly on the display must wait for any push in progress.
+  TFT_eSPI *_drawTo() {
+    if (_pushPending && _draw == &_lcd) {
+      _finishPush();
+    }
+    return _draw;
+  };
+  void _finishPush();
+  bool _textClipped(int16_t x, int16_t y);
+  bool _boundsClipped(int16_t x0, int16_t y0, int16_t x1, int16_t y1, int16_t x2, int16_t y2);
+
+  TFT_eSPI &_lcd;
+  PixelTransport *_transport; // If non-NULL, pushes sprites, alternating between the two.
+  // Off-screen buffers; allocated at first use, and kept until releaseOffscreen(). _sprite1 is only
+  // used with a transport.
+  TFT_eSprite _sprite0, _sprite1;
+  TFT_eSPI *_draw; // Either &_lcd or the current sprite.
+  uint8_t _cur; // Index of the sprite to draw into next.
+  bool _pushPending; // True if the transport may still be pushing a sprite.
+  bool _copyCheap; // Returned by isCopyCheap().
+  UIRect _area; // Off-screen area; its x/y are subtracted from all drawing coordinates.
+  int16_t _spriteW[2], _spriteH[2]; // Size each sprite was created with.
+  uint8_t _fontId; // Current text font; used to find the height of text for clipping.
+};
+
+#endif // __UIW_TFT_DRAW_TARGET_H
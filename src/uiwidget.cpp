@@ -3,14 +3,26 @@
 
 #include "uiwidgets.h"
 
+uint32_t UIWidget::_bgPixelsWritten = 0;
+uint32_t UIWidget::_layoutVersion = 0;
+uint32_t UIWidget::_boundsVersion = 0;
+DrawTarget *UIWidget::_layoutTarget = NULL;
+
+// Return the number of pixels of 'r' that drawing on 'lcd' can actually touch.
+static int32_t clippedArea(const DrawTarget &lcd, const UIRect &r) {
+  return lcd.hasClipRect() ? r.intersection(lcd.getClipRect()).area() : r.area();
+}
+
 void UIWidget::setBoundingBox(int16_t x, int16_t y, int16_t w, int16_t h) {
   // Update the bounding box for our own rendering.
   _x = x;
   _y = y;
   _w = w;
   _h = h;
+  _boundsVersion++;
 
   // Update the bounding boxes of any nested elements.
+  _childPass++; // Children not laid out again by cascadeBoundingBox() lose their parent link.
   cascadeBoundingBox();
 }
 
@@ -18,8 +30,8 @@ void UIWidget::setBorder(const border_flags_t flags, uint16_t color) {
   _border_flags = flags;
   _border_color = color;
 
-  // Update the bounding boxes of any nested elements.
-  cascadeBoundingBox();
+  // The bounding boxes of any nested elements must be updated.
+  invalidateLayout();
 }
 
 void UIWidget::setBackground(uint16_t color) {
@@ -33,7 +45,7 @@ void UIWidget::getRect(int16_t &cx, int16_t &cy, int16_t &cw, int16_t &ch) const
   ch = _h;
 }
 
-void UIWidget::drawBorder(TFT_eSPI &lcd, uint32_t renderFlags) {
+void UIWidget::drawBorder(DrawTarget &lcd, uint32_t renderFlags) {
   // TODO: Implement flex-height / flex-width border.
 
   if (_border_color == TRANSPARENT_COLOR) {
@@ -65,7 +77,7 @@ void UIWidget::drawBorder(TFT_eSPI &lcd, uint32_t renderFlags) {
   }
 }
 
-void UIWidget::drawBackground(TFT_eSPI &lcd, uint32_t renderFlags) {
+void UIWidget::drawBackground(DrawTarget &lcd, uint32_t renderFlags) {
   // TODO: Implement flex-height / flex-width background.
 
   if (_bg_color == TRANSPARENT_COLOR || (renderFlags & RF_NO_BACKGROUNDS) == RF_NO_BACKGROUNDS) {
@@ -76,8 +88,9 @@ void UIWidget::drawBackground(TFT_eSPI &lcd, uint32_t renderFlags) {
 
   if (_border_flags & BORDER_ROUNDED) {
     lcd.fillRoundRect(_x, _y, _w, _h, BORDER_ROUNDED_RADIUS, bg_color);
+    _bgPixelsWritten += clippedArea(lcd, getRect());
   } else {
-    lcd.fillRect(_x, _y, _w, _h, bg_color);
+    fillBackgroundRect(lcd, _x, _y, _w, _h, bg_color);
   }
 }
 
@@ -85,7 +98,7 @@ void UIWidget::drawBackground(TFT_eSPI &lcd, uint32_t renderFlags) {
  * Fill in the background that this widget would render underneath another widget being redrawn,
  * without filling in the background for this entire widget's surface area.
  */
-void UIWidget::drawBackgroundUnderWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
+void UIWidget::drawBackgroundUnderWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
   if (NULL == widget) {
     return;
   }
@@ -98,8 +111,33 @@ void UIWidget::drawBackgroundUnderWidget(UIWidget *widget, TFT_eSPI &lcd, uint32
     return; // Don't draw backgrounds in this refresh process.
   }
 
+  if ((renderFlags & RF_PARENT_BG_DRAWN) == RF_PARENT_BG_DRAWN) {
+    return; // The Screen already filled in the topmost background under 'widget'.
+  }
+
   uint16_t bg = isFocused(renderFlags) ? invertColor(_bg_color) : _bg_color;
-  lcd.fillRect(widget->_x, widget->_y, widget->_w, widget->_h, bg);
+  fillBackgroundRect(lcd, widget->_x, widget->_y, widget->_w, widget->_h, bg);
+}
+
+void UIWidget::fillBackgroundRect(DrawTarget &lcd, int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t color) {
+  lcd.fillRect(x, y, w, h, color);
+  UIRect r = { x, y, w, h };
+  _bgPixelsWritten += clippedArea(lcd, r);
+}
+
+uint16_t UIWidget::getChildBackground(uint32_t renderFlags) const {
+  if (_bg_color == TRANSPARENT_COLOR) {
+    return TRANSPARENT_COLOR;
+  }
+
+  return isFocused(renderFlags) ? invertColor(_bg_color) : _bg_color;
+}
+
+bool UIWidget::isOpaque(uint32_t renderFlags) const {
+  // drawBackground() covers the whole bounding box, unless the corners are rounded off.
+  return _bg_color != TRANSPARENT_COLOR && (_border_flags & BORDER_ROUNDED) == 0
+      && (renderFlags & RF_NO_BACKGROUNDS) == 0;
 }
 
 void UIWidget::setPadding(int16_t padL, int16_t padR, int16_t padT, int16_t padB) {
@@ -108,7 +146,7 @@ void UIWidget::setPadding(int16_t padL, int16_t padR, int16_t padT, int16_t padB
   _paddingTop = padT;
   _paddingBottom = padB;
 
-  cascadeBoundingBox();
+  invalidateLayout();
 }
 
 void UIWidget::getPadding(int16_t &padL, int16_t &padR, int16_t &padT, int16_t &padB) const {
@@ -118,6 +156,22 @@ void UIWidget::getPadding(int16_t &padL, int16_t &padR, int16_t &padT, int16_t &
   padB = _paddingBottom;
 }
 
+UIWidget *UIWidget::widgetAt(int16_t x, int16_t y) {
+  if (!containsPoint(x, y)) {
+    return NULL;
+  }
+
+  // Descend through the child at (x, y) at each level, as far as the point goes.
+  UIWidget *widget = this;
+  UIWidget *child = getChildAt(x, y);
+  while (child != NULL) {
+    widget = child;
+    child = widget->getChildAt(x, y);
+  }
+
+  return widget;
+}
+
 bool UIWidget::containsWidget(UIWidget *widget) const {
   if (NULL == widget) {
     return false;
@@ -147,7 +201,8 @@ bool UIWidget::containsWidget(UIWidget *widget) const {
   return false;
 }
 
-bool UIWidget::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
+bool UIWidget::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
   // Default implementation for widgets that do not contain nested/child widgets.
   if (NULL == widget) {
     return false;
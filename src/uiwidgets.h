@@ -7,6 +7,11 @@
 
 #include <TFT_eSPI.h>
 
+#include "rect.h"
+#include "draw_target.h"
+#include "render_stats.h"
+#include "pixel_transport.h"
+
 
 // When given for width or height argument, FLEX indicates that the widget size
 // should be dynamic w.r.t. fitting its contents.
@@ -19,6 +24,9 @@ constexpr int16_t EQUAL = -2;
 // A width or height return value indicating an error in the function call.
 constexpr int16_t ERROR_INVALID_ELEMENT = -3;
 
+// A cached width or height that has not been measured since the content last changed.
+constexpr int16_t SIZE_NOT_MEASURED = -4;
+
 // bitflags representing what border to draw around a given widget's bounding box.
 typedef uint16_t border_flags_t;
 constexpr border_flags_t BORDER_NONE   = 0x0;
@@ -55,20 +63,49 @@ class UIWidget {
 public:
   UIWidget(): _x(0), _y(0), _w(0), _h(0),
       _border_flags(BORDER_NONE), _border_color(TFT_WHITE), _bg_color(BG_NONE), _focused(false),
-      _paddingL(0), _paddingR(0), _paddingTop(0), _paddingBottom(0) {
+      _paddingL(0), _paddingR(0), _paddingTop(0), _paddingBottom(0),
+      _parent(NULL), _parentPass(0), _childPass(0) {
+#ifdef UIW_ENABLE_STATS
+    _stats.clear();
+#endif
   };
 
   virtual ~UIWidget() {};
 
   /** Render the widget to the screen, along with any child widgets. */
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags) = 0;
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags) = 0;
 
-  /** Set the bounding box for this widget. */
+  /**
+   * Set the bounding box for this widget, and lay out its children within it immediately. This is
+   * the primitive used by the layout pass (see invalidateLayout()).
+   */
   void setBoundingBox(int16_t x, int16_t y, int16_t w, int16_t h);
 
   /** Called by setBoundingBox(); cascades bounding box requirements to any child elements. */
   virtual void cascadeBoundingBox() { };
 
+  /**
+   * Note that this widget's children must be laid out again. Setters that affect layout (borders,
+   * padding, rows, columns, entries, etc.) call this rather than cascading bounding boxes right
+   * away, so that a burst of changes is laid out just once, by the Screen, before it next draws
+   * or looks up a widget (see Screen::updateLayout()).
+   *
+   * Only a global version is kept, not which widgets changed: a change to one widget's size can
+   * move any of its ancestors' other children, so the Screen lays out the whole tree again from
+   * the top. That pass costs about as much as setting every bounding box once.
+   */
+  void invalidateLayout() { _layoutVersion++; };
+
+  /**
+   * Return the container that holds this widget, as of the last time that container laid out its
+   * children, or NULL if there is none. Returns NULL for a widget that its container did not lay
+   * out in that pass, e.g. a VScroll entry that is scrolled out of view, or a widget that has
+   * since been removed.
+   */
+  UIWidget *getParent() const {
+    return (NULL != _parent && _parentPass == _parent->_childPass) ? _parent : NULL;
+  };
+
   void setBorder(const border_flags_t flags, uint16_t color=TFT_WHITE);
   /**
    * A color to fill in for the background, or BG_NONE for no background (i.e., inherit bg from
@@ -84,11 +121,12 @@ public:
 
   // Return the entire rect of getX(), getY(), getWidth() and getHeight().
   void getRect(int16_t &cx, int16_t &cy, int16_t &cw, int16_t &ch) const;
+  UIRect getRect() const { UIRect r = { _x, _y, _w, _h }; return r; };
 
   // Return width required for widget to render all content without overflow.
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const = 0;
+  virtual int16_t getContentWidth(DrawTarget &lcd) const = 0;
   // Return height required for widget to render all content without overflow.
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const = 0;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const = 0;
 
   // Return true if this item is explicitly focused with this->setFocus(true).
   bool isFocused() const { return _focused; };
@@ -104,12 +142,53 @@ public:
   bool containsWidget(UIWidget *widget) const;
   // Redraw only the part of the screen contained by widget 'widget'.
   // Returns true if we handled the redraw.
-  virtual bool redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+
+  // Return the immediate child of this widget through which 'widget' is drawn (possibly 'widget'
+  // itself), or NULL if 'widget' is not a visible descendant of this one.
+  virtual UIWidget *getChildContaining(UIWidget *widget) const { return NULL; };
+
+  // Return true if the pixel at (x, y) is within this widget's bounding box.
+  bool containsPoint(int16_t x, int16_t y) const { return getRect().containsPoint(x, y); };
+  // Return the visible immediate child of this widget at (x, y), or NULL if there is none.
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const { return NULL; };
+  /**
+   * Return the innermost visible widget at (x, y): this one or a descendant. Returns NULL if the
+   * point is outside this widget. Each container finds its child at the point directly, so this
+   * takes time in proportion to the depth of the tree. Call Screen::widgetAt() instead to be sure
+   * the layout is up to date.
+   */
+  UIWidget *widgetAt(int16_t x, int16_t y);
+  // Return the color this widget fills in underneath its child widgets, or TRANSPARENT_COLOR.
+  virtual uint16_t getChildBackground(uint32_t renderFlags) const;
+  // Return true if render() fills this widget's entire bounding box with an opaque background.
+  virtual bool isOpaque(uint32_t renderFlags) const;
+
+#ifdef UIW_ENABLE_STATS
+  // Return the draw activity and time spent in this widget (including its children) during the
+  // most recent frame in which it was laid out or drawn; getRenderStats().frame identifies that
+  // frame (compare with Screen::getLastFrameStats().frame).
+  const RenderStats &getRenderStats() const { return _stats; };
+#endif
 
 protected:
-  void drawBorder(TFT_eSPI &lcd, uint32_t renderFlags);
-  void drawBackground(TFT_eSPI &lcd, uint32_t renderFlags);
-  void drawBackgroundUnderWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+  void drawBorder(DrawTarget &lcd, uint32_t renderFlags);
+  void drawBackground(DrawTarget &lcd, uint32_t renderFlags);
+  void drawBackgroundUnderWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+
+  // Fill a rectangle as background, and tally its pixels toward _bgPixelsWritten.
+  static void fillBackgroundRect(DrawTarget &lcd, int16_t x, int16_t y, int16_t w, int16_t h,
+      uint16_t color);
+
+  /**
+   * Set the bounding box of 'child' (see setBoundingBox()) and record this widget as its parent
+   * (see getParent()). Containers lay out each of their children with this method.
+   */
+  void setChildBoundingBox(UIWidget *child, int16_t x, int16_t y, int16_t w, int16_t h) {
+    child->_parent = this;
+    child->_parentPass = _childPass;
+    child->setBoundingBox(x, y, w, h);
+  };
 
   /** Get area bounding box available for rendering within the context of any border or other
    * padding that belongs to this widget.
@@ -133,15 +212,43 @@ protected:
   // Additional user controlled interior padding.
   int16_t _paddingL, _paddingR, _paddingTop, _paddingBottom;
 
+  UIWidget *_parent; // The container that last laid out this widget, or NULL.
+  // Pass stamps are 32 bits wide: a VScroll bumps its _childPass on every scroll, and a 16-bit
+  // stamp would wrap soon enough to revive a stale link to an entry long since scrolled away.
+  uint32_t _parentPass; // _parent->_childPass as of when it did so.
+  uint32_t _childPass; // Incremented each time this widget lays out its children.
+
+  // Running count of pixels filled by background draws; reset by Screen around each redraw.
+  static uint32_t _bgPixelsWritten;
+  // Incremented by every invalidateLayout() call; Screen compares it against the value as of its
+  // last layout pass to tell if another is needed.
+  static uint32_t _layoutVersion;
+  // Incremented whenever any widget's bounding box is set, whether by a layout pass or by a
+  // container laying out its children directly (e.g. a VScroll scrolling). Screen replans a redraw
+  // in progress if it changes.
+  static uint32_t _boundsVersion;
+  // The DrawTarget whose text metrics size FLEX elements during layout; set by the Screen. If
+  // NULL, FLEX elements are sized as EQUAL ones.
+  static DrawTarget *_layoutTarget;
+
+#ifdef UIW_ENABLE_STATS
+  RenderStats _stats;
+#endif
+
   friend class Screen;
 };
 
 
+#include "tft_draw_target.h"
+#include "canvas.h"
 #include "screen.h"
 #include "panel.h"
 #include "row_col.h"
+#include "grid.h"
+#include "static_layout.h"
 #include "labels.h"
 #include "vscroll.h"
 #include "button.h"
+#include "widget_arena.h"
 
 #endif // __UI_WIDGETS_H
@@ -5,46 +5,301 @@
 // The button boxes at top and bottom of the scrollbar are 12 px tall.
 static constexpr int16_t scrollBoxWidgetHeight = 12;
 
-void VScroll::remove(UIWidget *widget) {
-  size_t idx = 0;
-  for (auto it = _entries.begin(); it != _entries.end(); it++) {
-    if (*it == widget) {
-      // Erase the element at cur iterator position.
-      _entries.erase(it);
-
-      // Move selection cursors up by 1 if they're below this, or remove if they're on this entry.
-      if (_selectIdx != NO_SELECTION && _selectIdx > idx) {
-        _selectIdx--;
-      } else if (_selectIdx == idx) {
-        _selectIdx = NO_SELECTION;
+// Return the lowest set bit of 'i'; Fenwick tree node i covers this many values.
+static inline size_t lowBit(size_t i) {
+  return i & (~i + 1);
+}
+
+// Return the sum of the first 'n' values in the Fenwick tree 'tree'.
+static int32_t treePrefix(const int32_t *tree, size_t n) {
+  int32_t sum = 0;
+  for (; n > 0; n -= lowBit(n)) {
+    sum += tree[n];
+  }
+
+  return sum;
+}
+
+// Add 'delta' to value 'idx' of the Fenwick tree 'tree', which holds 'n' values.
+static void treeAdd(int32_t *tree, size_t n, size_t idx, int32_t delta) {
+  for (size_t i = idx + 1; i <= n; i += lowBit(i)) {
+    tree[i] += delta;
+  }
+}
+
+VScroll::~VScroll() {
+  if (!_fixedCapacity) {
+    delete [] _entries;
+  }
+
+  _freeHeightIndex();
+}
+
+bool VScroll::insert(size_t idx, UIWidget *const *widgets, size_t count) {
+  if (NULL != _adapter) {
+    return false; // Entries come from the adapter.
+  } else if (_numEntries + count > _capacity && !_growEntries(_numEntries + count)) {
+    return false; // No room.
+  }
+
+  idx = min(idx, _numEntries);
+  for (size_t i = _numEntries; i > idx; i--) {
+    _entries[i + count - 1] = _entries[i - 1];
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    _entries[idx + i] = widgets[i];
+  }
+
+  size_t oldNumEntries = _numEntries;
+  _numEntries += count;
+
+  if (NULL != _heights) {
+    for (size_t i = oldNumEntries; i > idx; i--) {
+      _heights[i + count - 1] = _heights[i - 1];
+    }
+
+    if (_firstUnmeasured >= idx) {
+      _firstUnmeasured += count; // Any unmeasured entries among those moved.
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      _heights[idx + i] = _newEntryHeight(idx + i, widgets[i]);
+    }
+
+    if (idx < oldNumEntries) {
+      _rebuildHeightIndex(); // Every sum from here on has shifted.
+    } else {
+      // Appending; each new tree node sums its height with those of the values it covers.
+      for (size_t i = oldNumEntries + 1; i <= _numEntries; i++) {
+        _heightIndex[i] = _heightOf(i - 1) + treePrefix(_heightIndex, i - 1)
+            - treePrefix(_heightIndex, i - lowBit(i));
+      }
+    }
+  }
+
+  // Move selection cursors down past the inserted entries.
+  if (_selectIdx != NO_SELECTION && _selectIdx >= idx) {
+    _selectIdx += count;
+  }
+
+  if (_priorSelectIdx != NO_SELECTION && _priorSelectIdx >= idx) {
+    _priorSelectIdx += count;
+  }
+
+  _drawnTopIdx = VSCROLL_NO_ENTRY; // Rows on screen may have moved.
+  invalidateLayout();
+  return true;
+}
+
+// Grow a heap-allocated entry list, doubling its capacity until it holds at least 'minCapacity'
+// entries. Returns false if it cannot grow.
+bool VScroll::_growEntries(size_t minCapacity) {
+  if (_fixedCapacity) {
+    return false;
+  }
+
+  size_t newCapacity = _capacity > 0 ? 2 * _capacity : 8;
+  while (newCapacity < minCapacity) {
+    newCapacity *= 2;
+  }
+
+  UIWidget **newEntries = new UIWidget*[newCapacity];
+  for (size_t i = 0; i < _numEntries; i++) {
+    newEntries[i] = _entries[i];
+  }
+
+  delete [] _entries;
+  _entries = newEntries;
+
+  if (NULL != _heights) {
+    // Tree nodes for the existing values don't depend on the capacity, so they carry over.
+    int16_t *newHeights = new int16_t[newCapacity];
+    int32_t *newHeightIndex = new int32_t[newCapacity + 1];
+    for (size_t i = 0; i < _numEntries; i++) {
+      newHeights[i] = _heights[i];
+    }
+
+    for (size_t i = 0; i <= _numEntries; i++) {
+      newHeightIndex[i] = _heightIndex[i];
+    }
+
+    delete [] _heights;
+    delete [] _heightIndex;
+    _heights = newHeights;
+    _heightIndex = newHeightIndex;
+  }
+
+  _capacity = newCapacity;
+  return true;
+}
+
+void VScroll::removeAt(size_t idx, size_t count) {
+  if (NULL != _adapter || idx >= _numEntries) {
+    return; // Entries come from the adapter, or there is nothing to remove.
+  }
+
+  // Erase the entries in this range, shifting the remainder up by 'count'.
+  count = min(count, _numEntries - idx);
+  _numEntries -= count;
+  for (size_t i = idx; i < _numEntries; i++) {
+    _entries[i] = _entries[i + count];
+  }
+
+  if (NULL != _heights) {
+    for (size_t i = idx; i < idx + count; i++) {
+      if (_heights[i] == SIZE_NOT_MEASURED) {
+        _numUnmeasured--;
       }
+    }
+
+    for (size_t i = idx; i < _numEntries; i++) {
+      _heights[i] = _heights[i + count];
+    }
+
+    if (_firstUnmeasured >= idx + count) {
+      _firstUnmeasured -= count;
+    } else if (_firstUnmeasured > idx) {
+      _firstUnmeasured = idx;
+    }
+
+    if (idx < _numEntries) {
+      _rebuildHeightIndex(); // Removing from the end leaves the sums of the rest intact.
+    }
+  }
+
+  // Move selection cursors up if they're below this, or remove if they're on a removed entry.
+  if (_selectIdx != NO_SELECTION && _selectIdx >= idx + count) {
+    _selectIdx -= count;
+  } else if (_selectIdx != NO_SELECTION && _selectIdx >= idx) {
+    _selectIdx = NO_SELECTION;
+  }
+
+  if (_priorSelectIdx != NO_SELECTION && _priorSelectIdx >= idx + count) {
+    _priorSelectIdx -= count;
+  } else if (_priorSelectIdx != NO_SELECTION && _priorSelectIdx >= idx) {
+    _priorSelectIdx = NO_SELECTION;
+  }
 
-      if (_priorSelectIdx != NO_SELECTION && _priorSelectIdx > idx) {
-        _priorSelectIdx--;
-      } else if (_priorSelectIdx == idx) {
-        _priorSelectIdx = NO_SELECTION;
+  // Keep the same entry at the top if it remains; otherwise show what followed the removed ones.
+  // Then scroll up as needed to keep the last page full.
+  if (_topIdx >= idx + count) {
+    _topIdx -= count;
+  } else if (_topIdx > idx) {
+    _topIdx = idx;
+  }
+  _topIdx = min(_topIdx, _maxTopIdx());
+
+  _drawnTopIdx = VSCROLL_NO_ENTRY; // Rows on screen may have moved.
+  invalidateLayout();
+}
+
+size_t VScroll::indexOf(const UIWidget *widget) const {
+  if (NULL == _adapter) {
+    // Check the visible entries first; they're the ones most likely to be looked up.
+    size_t lastIdx = min(_lastIdx, _numEntries);
+    for (size_t i = _topIdx; i < lastIdx; i++) {
+      if (_entries[i] == widget) {
+        return i;
       }
+    }
 
-      cascadeBoundingBox();
-      return; // All done.
+    for (size_t i = 0; i < _numEntries; i++) {
+      if (_entries[i] == widget) {
+        return i;
+      }
+    }
+  } else {
+    // Only the visible entries have widgets.
+    for (size_t i = _boundTop; i < _boundEnd; i++) {
+      if (_rows[i % _numRows] == widget) {
+        return i;
+      }
     }
+  }
+
+  return VSCROLL_NO_ENTRY;
+}
+
+void VScroll::setAdapter(VScrollAdapter *adapter, UIWidget **rows, size_t numRows) {
+  if (NULL != adapter && !_fixedCapacity) {
+    // Free the list of entries; only the rows are needed now.
+    delete [] _entries;
+    _entries = NULL;
+    _capacity = 0;
+  }
+
+  _adapter = (NULL != rows && numRows > 0) ? adapter : NULL;
+  _rows = rows;
+  _numRows = numRows;
+  _numEntries = 0;
+  if (NULL != _adapter || !_flexHeights) {
+    _freeHeightIndex(); // Entries from an adapter, or added later, all get _itemHeight.
+  } else {
+    _numUnmeasured = 0;
+    _firstUnmeasured = _numEntries;
+    _enableHeightIndex();
+  }
+
+  _topIdx = 0;
+  _selectIdx = NO_SELECTION;
+  _priorSelectIdx = NO_SELECTION;
+  dataChanged();
+}
+
+void VScroll::dataChanged() {
+  if (NULL != _adapter) {
+    _numEntries = _adapter->count();
+  }
+
+  if (_selectIdx != NO_SELECTION && _selectIdx >= _numEntries) {
+    _selectIdx = NO_SELECTION;
+  }
+
+  if (_priorSelectIdx != NO_SELECTION && _priorSelectIdx >= _numEntries) {
+    _priorSelectIdx = NO_SELECTION;
+  }
+
+  // If the list shrank, scroll up as needed to keep the last page full.
+  _topIdx = min(_topIdx, _maxTopIdx());
+  _boundEnd = _boundTop; // Nothing is bound; the next layout binds every visible row.
+  _drawnTopIdx = VSCROLL_NO_ENTRY;
+  invalidateLayout();
+}
 
-    idx++;
+/**
+ * Return the row to show entry 'idx' with, first binding it to that entry unless it already is.
+ * Called for each visible entry, in order, by cascadeBoundingBox(); entries that were visible at
+ * the previous layout keep their rows, so scrolling by one entry rebinds just one row.
+ */
+UIWidget *VScroll::_bindRow(size_t idx) {
+  UIWidget *row = _rows[idx % _numRows];
+  if (idx < _boundTop || idx >= _boundEnd) {
+    _adapter->bindRow(row, idx);
+    row->setFocus(idx == _selectIdx);
   }
+
+  return row;
 }
 
-void VScroll::render(TFT_eSPI &lcd, uint32_t renderFlags) {
+void VScroll::render(DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_RENDER);
   if (_content_bg_color != TRANSPARENT_COLOR && (renderFlags & RF_NO_BACKGROUNDS) == 0) {
     // Instead of the standard drawBackground(), we fill the content area
     // with the content-area-specific background color.
-    lcd.fillRect(_x, _y, _w - VSCROLL_SCROLLBAR_W, _h, _content_bg_color);
+    fillBackgroundRect(lcd, _x, _y, _w - VSCROLL_SCROLLBAR_W, _h, _content_bg_color);
   }
 
   if ((renderFlags & RF_WIDGET_SPECIFIC) == 0
-      || (renderFlags & RF_VSCROLL_SCROLLBAR) == RF_VSCROLL_SCROLLBAR) {
+      || (renderFlags & RF_VSCROLL_SCROLLBAR) == RF_VSCROLL_SCROLLBAR
+      || (renderFlags & RF_VSCROLL_SHIFT) == RF_VSCROLL_SHIFT) {
     // We should draw the scrollbar (explicit directive, or no widget-specific guidance / draw all).
-    // Border, if any, also redrawn in this directive.
-    _renderScrollbar(lcd, renderFlags);
+    // Border, if any, also redrawn in this directive. After scrolling, just move the thumb if we can.
+    bool thumbOnly = (renderFlags & RF_VSCROLL_SHIFT) == RF_VSCROLL_SHIFT
+        && (renderFlags & RF_VSCROLL_SCROLLBAR) != RF_VSCROLL_SCROLLBAR;
+    if (!thumbOnly || !_moveScrollbarThumb(lcd, renderFlags)) {
+      _renderScrollbar(lcd, renderFlags);
+    }
   }
 
   if (isFocused(renderFlags)) {
@@ -56,13 +311,33 @@ void VScroll::render(TFT_eSPI &lcd, uint32_t renderFlags) {
       || (renderFlags & RF_VSCROLL_CONTENT) == RF_VSCROLL_CONTENT) {
     // We should draw all the content (explicit directive, or no widget-specific guidance / draw all).
     _renderContentArea(lcd, renderFlags);
+  } else if ((renderFlags & RF_VSCROLL_SHIFT) == RF_VSCROLL_SHIFT) {
+    // Move the rows already drawn to where they are now scrolled to, and fill in the rest. Rows
+    // rendered here are drawn in full, backgrounds and all; the flags specific to this VScroll
+    // mean nothing to them.
+    uint32_t rowFlags = renderFlags & ~(RF_WIDGET_SPECIFIC_MASK | RF_NO_BACKGROUNDS);
+    if (!lcd.isCopyCheap() || !_shiftContentArea(lcd, rowFlags)) {
+      int16_t x, y, w, h;
+      _getEntryArea(x, y, w, h);
+      _renderRows(lcd, rowFlags, y, y + h);
+    } else if ((renderFlags & RF_VSCROLL_SELECTED) == RF_VSCROLL_SELECTED) {
+      // The rows whose selection changed were moved with their old highlight; repaint them.
+      size_t lastIdx = min(_lastIdx, _numEntries);
+      for (size_t i = _topIdx; i < lastIdx; i++) {
+        UIWidget *pEntry = (i == _selectIdx || i == _priorSelectIdx) ? _entry(i) : NULL;
+        if (pEntry != NULL) {
+          UIRect row = pEntry->getRect();
+          _renderRows(lcd, rowFlags, row.y, row.y + row.h);
+        }
+      }
+    }
   } else if ((renderFlags & RF_VSCROLL_SELECTED) == RF_VSCROLL_SELECTED) {
     // We should redraw only the content area rows indicated by _selectIdx and _priorSelectIdx.
     // Iterate through all the visible entries and render the appropriate ones.
     for (size_t i = _topIdx; i < _lastIdx; i++) {
       if (i == _selectIdx || i == _priorSelectIdx) {
-        UIWidget *pEntry = _entries[i];
-        if (pEntry != NULL) {
+        UIWidget *pEntry = _entry(i);
+        if (pEntry != NULL && lcd.intersectsClip(pEntry->getRect())) {
           pEntry->render(lcd, renderFlags);
         }
       }
@@ -70,17 +345,23 @@ void VScroll::render(TFT_eSPI &lcd, uint32_t renderFlags) {
   }
 }
 
-void VScroll::_renderScrollbar(TFT_eSPI &lcd, uint32_t renderFlags) {
+void VScroll::_renderScrollbar(DrawTarget &lcd, uint32_t renderFlags) {
   // X position of the left-most edge of the scrollbar.
   int16_t scrollbarX = _x + _w - VSCROLL_SCROLLBAR_W;
 
+  UIRect scrollbarRect = { scrollbarX, _y, VSCROLL_SCROLLBAR_W, _h };
+  if (!lcd.intersectsClip(scrollbarRect)) {
+    drawBorder(lcd, renderFlags); // The scrollbar itself is entirely outside the clip rect.
+    return;
+  }
+
+  uint16_t scrollbarBg = isFocused(renderFlags) ? invertColor(_scrollbar_bg_color) : _scrollbar_bg_color;
   if (_scrollbar_bg_color != TRANSPARENT_COLOR) {
     // Fill in the background of the scrollbar area.
     // Since the left & right edges will be taken up completely with the vertical borders of
     // the scrollbar, do not include them in the fill. The areas near the top and bottom
     // containing the carets will also be filled in renderScrollUp()/renderScrollDown(), so
     // we only need to focus on the main scroll indicator.
-    uint16_t scrollbarBg = isFocused(renderFlags) ? invertColor(_scrollbar_bg_color) : _scrollbar_bg_color;
     lcd.fillRect(scrollbarX + 1, _y + scrollBoxWidgetHeight + 1,
         VSCROLL_SCROLLBAR_W - 2, _h - 2 * scrollBoxWidgetHeight - 1,
         scrollbarBg);
@@ -105,28 +386,204 @@ void VScroll::_renderScrollbar(TFT_eSPI &lcd, uint32_t renderFlags) {
   renderScrollDown(lcd, false, renderFlags);
 
   // Draw the scroll position indicator.
+  int16_t thumbY = _thumbY();
+  lcd.fillRect(scrollbarX, thumbY, VSCROLL_SCROLLBAR_W, scrollBoxWidgetHeight, scrollbarColor);
+
+  // Remember what is now on screen, if all of it was drawn, for RF_VSCROLL_SHIFT.
+  bool drawnInFull = !lcd.hasClipRect() || lcd.getClipRect().contains(scrollbarRect);
+  _drawnScrollbar = scrollbarRect;
+  _drawnThumbY = drawnInFull ? thumbY : VSCROLL_THUMB_NOT_DRAWN;
+  _drawnScrollbarColor = scrollbarColor;
+  _drawnScrollbarBg = scrollbarBg;
+}
+
+// Return the y position of the scroll position indicator (the thumb) for the current position.
+int16_t VScroll::_thumbY() const {
   // Use MacOS-style fixed-size box whose position is proportional to the position of the viewing
   // window. The viewing window is at the "bottom" is when the last screenful of rows are shown,
   // so remove that many items from _elements.size() when calculating this percentage.
-  float frac = min(1.0, (float)_topIdx / max(1, (signed)_entries.size() - (_h / _itemHeight)));
+  float frac;
+  if (NULL == _heights) {
+    frac = min(1.0, (float)_topIdx / max(1, (signed)_numEntries - (_h / max(_itemHeight, (int16_t)1))));
+  } else {
+    // Entries differ in height, so measure the window's position in pixels instead.
+    int16_t x, y, w, h;
+    _getEntryArea(x, y, w, h);
+    frac = min(1.0, (float)_entryOffset(_topIdx) / max((int32_t)1, _entryOffset(_numEntries) - h));
+  }
+
   int16_t boxStart = frac * (_h - 3 * scrollBoxWidgetHeight);
-  lcd.fillRect(scrollbarX, _y + scrollBoxWidgetHeight + boxStart,
-      VSCROLL_SCROLLBAR_W, scrollBoxWidgetHeight, scrollbarColor);
+  return _y + scrollBoxWidgetHeight + boxStart;
 }
 
-void VScroll::_renderContentArea(TFT_eSPI &lcd, uint32_t renderFlags) {
+/**
+ * Bring the scrollbar up to date after scrolling, by repainting just the part of the thumb that
+ * moved since the scrollbar was last drawn, and any chevrons last drawn active. Returns false,
+ * having drawn nothing, if the scrollbar must be redrawn in full instead.
+ */
+bool VScroll::_moveScrollbarThumb(DrawTarget &lcd, uint32_t renderFlags) {
+  // X position of the left-most edge of the scrollbar.
+  int16_t scrollbarX = _x + _w - VSCROLL_SCROLLBAR_W;
+  UIRect scrollbarRect = { scrollbarX, _y, VSCROLL_SCROLLBAR_W, _h };
+  uint16_t scrollbarBg = isFocused(renderFlags) ? invertColor(_scrollbar_bg_color) : _scrollbar_bg_color;
+  uint16_t scrollbarColor = isFocused(renderFlags) ? invertColor(_border_color) : _border_color;
+  if (_scrollbar_bg_color == TRANSPARENT_COLOR || _drawnThumbY == VSCROLL_THUMB_NOT_DRAWN
+      || !(scrollbarRect == _drawnScrollbar) || scrollbarColor != _drawnScrollbarColor
+      || scrollbarBg != _drawnScrollbarBg
+      || (lcd.hasClipRect() && !lcd.getClipRect().contains(scrollbarRect))) {
+    return false; // Can't erase the old thumb, or don't know what's on screen.
+  }
+
+  if (_upActive) {
+    renderScrollUp(lcd, false, renderFlags);
+  }
+
+  if (_downActive) {
+    renderScrollDown(lcd, false, renderFlags);
+  }
+
+  int16_t thumbY = _thumbY();
+  if (thumbY == _drawnThumbY) {
+    return true; // Didn't move.
+  }
+
+  // Erase the part of the old thumb that the new one doesn't cover, restoring the outline it was
+  // drawn over; then draw the part of the new thumb that the old one didn't cover.
+  int16_t oldTop = _drawnThumbY;
+  int16_t oldBottom = _drawnThumbY + scrollBoxWidgetHeight;
+  int16_t newTop = thumbY;
+  int16_t newBottom = thumbY + scrollBoxWidgetHeight;
+  int16_t eraseTop = newTop > oldTop ? oldTop : max(oldTop, newBottom);
+  int16_t eraseBottom = newTop > oldTop ? min(oldBottom, newTop) : oldBottom;
+  lcd.fillRect(scrollbarX + 1, eraseTop, VSCROLL_SCROLLBAR_W - 2, eraseBottom - eraseTop,
+      scrollbarBg);
+  lcd.drawFastVLine(scrollbarX, eraseTop, eraseBottom - eraseTop, scrollbarColor);
+  lcd.drawFastVLine(_x + _w - 1, eraseTop, eraseBottom - eraseTop, scrollbarColor);
+
+  // The thumb may also have covered the outline of the ^ or v box.
+  int16_t upBoxLine = _y + scrollBoxWidgetHeight;
+  int16_t downBoxLine = _y + _h - 1 - scrollBoxWidgetHeight;
+  if (upBoxLine >= eraseTop && upBoxLine < eraseBottom) {
+    lcd.drawFastHLine(scrollbarX, upBoxLine, VSCROLL_SCROLLBAR_W, scrollbarColor);
+  }
+
+  if (downBoxLine >= eraseTop && downBoxLine < eraseBottom) {
+    lcd.drawFastHLine(scrollbarX, downBoxLine, VSCROLL_SCROLLBAR_W, scrollbarColor);
+  }
+
+  int16_t drawTop = newTop > oldTop ? max(newTop, oldBottom) : newTop;
+  int16_t drawBottom = newTop > oldTop ? newBottom : min(newBottom, oldTop);
+  lcd.fillRect(scrollbarX, drawTop, VSCROLL_SCROLLBAR_W, drawBottom - drawTop, scrollbarColor);
+
+  _drawnThumbY = thumbY;
+  return true;
+}
+
+void VScroll::_renderContentArea(DrawTarget &lcd, uint32_t renderFlags) {
   // Iterate through all the visible entries and render them.
   for (size_t i = _topIdx; i < _lastIdx; i++) {
-    UIWidget *pEntry = _entries[i];
-    if (pEntry != NULL) {
+    UIWidget *pEntry = _entry(i);
+    if (pEntry != NULL && lcd.intersectsClip(pEntry->getRect())) {
+      pEntry->render(lcd, renderFlags); // Skip entries entirely outside the clip rect.
+    }
+  }
+
+  // Remember what is now on screen, if all of it was drawn, for RF_VSCROLL_SHIFT.
+  int16_t x, y, w, h;
+  _getEntryArea(x, y, w, h);
+  UIRect area = { x, y, w, h };
+  bool drawnInFull = !lcd.hasClipRect() || lcd.getClipRect().contains(area);
+  _drawnArea = area;
+  _drawnTopIdx = (drawnInFull && !_visibleGaps) ? _topIdx : VSCROLL_NO_ENTRY;
+}
+
+/**
+ * Bring the content area up to date after scrolling, by moving the rows drawn at the last full
+ * redraw to their new positions and rendering only the rows that were not on screen then. Returns
+ * false, having drawn nothing, if the content area must be redrawn in full instead.
+ */
+bool VScroll::_shiftContentArea(DrawTarget &lcd, uint32_t renderFlags) {
+  int16_t x, y, w, h;
+  _getEntryArea(x, y, w, h);
+  UIRect area = { x, y, w, h };
+  if (_content_bg_color == TRANSPARENT_COLOR || _drawnTopIdx == VSCROLL_NO_ENTRY || _visibleGaps
+      || !(area == _drawnArea)) {
+    return false; // Can't clear the exposed rows, or don't know what's on screen.
+  }
+
+  // Distance to move the drawn rows up the screen (down, if negative).
+  int32_t shift = _entryOffset(_topIdx) - _entryOffset(_drawnTopIdx);
+  if (shift >= h || -shift >= h) {
+    return false; // None of the drawn rows remain on screen.
+  } else if (shift > 0) {
+    if (!lcd.copyRect(x, y + shift, w, h - shift, x, y)) {
+      return false;
+    }
+    _renderRows(lcd, renderFlags, y + h - shift, y + h);
+  } else if (shift < 0) {
+    if (!lcd.copyRect(x, y, w, h + shift, x, y - shift)) {
+      return false;
+    }
+    _renderRows(lcd, renderFlags, y, y - shift);
+
+    size_t lastIdx = min(_lastIdx, _numEntries);
+    UIWidget *pLast = lastIdx > _topIdx ? _entry(lastIdx - 1) : NULL;
+    if (pLast != NULL && pLast->getRect().h < _heightOf(lastIdx - 1)) {
+      // The bottom row is cut short; it now shows the top of a row that was drawn at full height.
+      _renderRows(lcd, renderFlags, pLast->getRect().y, y + h);
+    }
+  }
+
+  _drawnTopIdx = _topIdx;
+  return true;
+}
+
+/**
+ * Render the rows of the content area that overlap 'top' to 'bottom' (exclusive), over the
+ * content background. Rows that extend above 'top' are filled in and rendered in full.
+ */
+void VScroll::_renderRows(DrawTarget &lcd, uint32_t renderFlags, int16_t top, int16_t bottom) {
+  int16_t x, y, w, h;
+  _getEntryArea(x, y, w, h);
+  if (top <= y && bottom >= y + h) {
+    if (_content_bg_color != TRANSPARENT_COLOR) {
+      fillBackgroundRect(lcd, x, y, w, h, _content_bg_color);
+    }
+    _renderContentArea(lcd, renderFlags);
+    return;
+  }
+
+  // Find the first visible row that reaches below 'top'.
+  size_t lastIdx = min(_lastIdx, _numEntries);
+  size_t idx = _topIdx;
+  for (; idx < lastIdx; idx++) {
+    UIWidget *pEntry = _entry(idx);
+    if (pEntry != NULL && pEntry->getRect().y + pEntry->getRect().h > top) {
+      top = min(top, pEntry->getRect().y);
+      break;
+    }
+  }
+
+  if (_content_bg_color != TRANSPARENT_COLOR) {
+    fillBackgroundRect(lcd, x, top, w, bottom - top, _content_bg_color);
+  }
+
+  for (; idx < lastIdx; idx++) {
+    UIWidget *pEntry = _entry(idx);
+    if (pEntry == NULL) {
+      continue;
+    } else if (pEntry->getRect().y >= bottom) {
+      break;
+    } else if (lcd.intersectsClip(pEntry->getRect())) {
       pEntry->render(lcd, renderFlags);
     }
   }
 }
 
-void VScroll::renderScrollUp(TFT_eSPI &lcd, bool btnActive, uint32_t renderFlags) {
+void VScroll::renderScrollUp(DrawTarget &lcd, bool btnActive, uint32_t renderFlags) {
   // X position of the left-most edge of the scrollbar.
   int16_t scrollbarX = _x + _w - VSCROLL_SCROLLBAR_W;
+  _upActive = btnActive;
 
   if (_scrollbar_bg_color != TRANSPARENT_COLOR) {
     // Fill in the background of the scrollbar area under the caret.
@@ -153,9 +610,10 @@ void VScroll::renderScrollUp(TFT_eSPI &lcd, bool btnActive, uint32_t renderFlags
   }
 }
 
-void VScroll::renderScrollDown(TFT_eSPI &lcd, bool btnActive, uint32_t renderFlags) {
+void VScroll::renderScrollDown(DrawTarget &lcd, bool btnActive, uint32_t renderFlags) {
   // X position of the left-most edge of the scrollbar.
   int16_t scrollbarX = _x + _w - VSCROLL_SCROLLBAR_W;
+  _downActive = btnActive;
 
   if (_scrollbar_bg_color != TRANSPARENT_COLOR) {
     // Fill in the background of the scrollbar area under the caret.
@@ -183,7 +641,8 @@ void VScroll::renderScrollDown(TFT_eSPI &lcd, bool btnActive, uint32_t renderFla
 }
 
 
-bool VScroll::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags) {
+bool VScroll::redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags) {
+  UIW_STATS_SCOPE(_stats, STATS_REDRAW);
   if (NULL == widget) {
     return false;
   } else if (this == widget) {
@@ -203,15 +662,19 @@ bool VScroll::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t render
 
     // Iterate through all the entries and check.
     for (size_t i = _topIdx; i < _lastIdx; i++) {
-      UIWidget *pEntry = _entries[i];
+      UIWidget *pEntry = _entry(i);
       if (pEntry != NULL && pEntry->containsWidget(widget)) {
         // Found a visible row that applies to this widget.
-        if ((renderFlags & RF_NO_BACKGROUNDS) == 0 && _content_bg_color != TRANSPARENT_COLOR) {
+        // If the Screen already filled the background under 'widget' and that's exactly this
+        // entry, it need not be filled again.
+        bool bgDrawn = pEntry == widget && (renderFlags & RF_PARENT_BG_DRAWN) == RF_PARENT_BG_DRAWN;
+        if ((renderFlags & RF_NO_BACKGROUNDS) == 0 && _content_bg_color != TRANSPARENT_COLOR
+            && !bgDrawn) {
           // Instead of the standard drawBackground(), we fill the content area
           // with the content-area-specific background color.
           int16_t cx, cy, cw, ch;
           pEntry->getRect(cx, cy, cw, ch);
-          lcd.fillRect(cx, cy, cw, ch, _content_bg_color);
+          fillBackgroundRect(lcd, cx, cy, cw, ch, _content_bg_color);
         }
         pEntry->render(lcd, renderFlags);
         return true;
@@ -222,66 +685,339 @@ bool VScroll::redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t render
   return false;
 }
 
-void VScroll::cascadeBoundingBox() {
-  // Recompute bounding boxes for visible items.
+UIWidget *VScroll::getChildContaining(UIWidget *widget) const {
+  // Only the visible entries are considered; see redrawChildWidget().
+  for (size_t i = _topIdx; i < _lastIdx; i++) {
+    UIWidget *pEntry = _entry(i);
+    if (pEntry != NULL && pEntry->containsWidget(widget)) {
+      return pEntry;
+    }
+  }
+
+  return NULL;
+}
+
+UIWidget *VScroll::getChildAt(int16_t x, int16_t y) const {
+  size_t lastIdx = min(_lastIdx, _numEntries); // In case entries were removed since layout.
+  if (_topIdx >= lastIdx) {
+    return NULL; // Nothing visible.
+  }
+
+  // Visible entries are stacked one per _itemHeight from the top of the content area (or, with
+  // variable heights, at the offsets in the height index), so the one at (x, y) can be found
+  // directly...
   int16_t childX, childY, childW, childH;
   getChildAreaBoundingBox(childX, childY, childW, childH);
-  // Because the scrollbar is on the right and clobbers the border there, we disregard childW
-  // and recalculate it ourselves.
-  childW = _w;
+  if (y >= childY && (NULL != _heights || _itemHeight > 0)) {
+    size_t idx = (NULL == _heights) ? _topIdx + (y - childY) / _itemHeight
+        : _findEntry(_entryOffset(_topIdx) + (y - childY));
+    UIWidget *pEntry = (idx >= _topIdx && idx < lastIdx) ? _entry(idx) : NULL;
+    if (pEntry != NULL && pEntry->containsPoint(x, y)) {
+      return pEntry;
+    }
+  }
+
+  // ... unless NULL entries (which take no space) are visible; then search for it.
+  for (size_t i = _topIdx; i < lastIdx; i++) {
+    UIWidget *pEntry = _entry(i);
+    if (pEntry != NULL && pEntry->containsPoint(x, y)) {
+      return pEntry;
+    }
+  }
+
+  return NULL;
+}
+
+// Return the area that entries are laid out in: the child area, less room for the scrollbar.
+void VScroll::_getEntryArea(int16_t &x, int16_t &y, int16_t &w, int16_t &h) const {
+  getChildAreaBoundingBox(x, y, w, h);
+  // Because the scrollbar is on the right and clobbers the border there, we disregard the child
+  // area width and recalculate it ourselves.
+  w = _w;
   // Calculate width adjustment for left-side border.
   if (_border_flags & BORDER_LEFT) {
-    childW -= BORDER_ACTIVE_INNER_MARGIN;
+    w -= BORDER_ACTIVE_INNER_MARGIN;
   } else if (_border_flags & BORDER_ROUNDED) {
-    childW -= BORDER_ROUNDED_INNER_MARGIN;
+    w -= BORDER_ROUNDED_INNER_MARGIN;
   }
-  childW -= _paddingL + _paddingR; // Adjust width to compensate for user-specified padding.
+  w -= _paddingL + _paddingR; // Adjust width to compensate for user-specified padding.
 
   // Adjust width to provide room for the scrollbar.
-  childW -= VSCROLL_SCROLLBAR_W + VSCROLL_SCROLLBAR_MARGIN;
+  w -= VSCROLL_SCROLLBAR_W + VSCROLL_SCROLLBAR_MARGIN;
+}
 
-  size_t idx = 0;
-  for (auto it = _entries.begin(); it < _entries.end() && childH > 0; idx++, it++) {
-    if (idx < _topIdx) {
-      // Not part of the visible set of entries; just skip it.
-      continue;
-    }
+void VScroll::cascadeBoundingBox() {
+  UIW_STATS_SCOPE(_stats, STATS_LAYOUT);
+  _laidOutVersion = _layoutVersion;
+
+  // Recompute bounding boxes for visible items.
+  int16_t childX, childY, childW, childH;
+  _getEntryArea(childX, childY, childW, childH);
+
+  // Entries before _topIdx are not part of the visible set. With an adapter, there are only
+  // enough rows to show _numRows entries.
+  if (_numUnmeasured > 0) {
+    _measureHeights();
+  }
 
-    UIWidget *pEntry = *it;
+  size_t idx = min(_topIdx, _numEntries);
+  size_t endIdx = (NULL == _adapter) ? _numEntries : min(_numEntries, idx + _numRows);
+  size_t firstIdx = idx;
+  _visibleGaps = false;
+  for (; idx < endIdx && childH > 0; idx++) {
+    UIWidget *pEntry = (NULL == _adapter) ? _entries[idx] : _bindRow(idx);
     if (pEntry == NULL) {
-      // Empty entry; takes zero height.
+      // Empty entry; takes zero height. (With variable heights, it is indexed with zero height.)
+      _visibleGaps = _visibleGaps || NULL == _heights;
       continue;
     }
 
-    pEntry->setBoundingBox(childX, childY, childW, min(_itemHeight, childH));
-    childY += _itemHeight; // Next item is further down by 1 item height.
-    childH -= _itemHeight; // Next item's available height reduced by 1 item height.
+    int16_t entryHeight = _heightOf(idx);
+    setChildBoundingBox(pEntry, childX, childY, childW, min(entryHeight, childH));
+    childY += entryHeight; // Next item is further down by this item's height.
+    childH -= entryHeight; // Next item's available height reduced by this item's height.
   }
 
   _lastIdx = idx;
+  _boundTop = firstIdx;
+  _boundEnd = idx;
 }
 
-int16_t VScroll::getContentWidth(TFT_eSPI &lcd) const {
+int16_t VScroll::getContentWidth(DrawTarget &lcd) const {
   return _w; // We always flex to the width of our container.
 }
 
-int16_t VScroll::getContentHeight(TFT_eSPI &lcd) const {
+int16_t VScroll::getContentHeight(DrawTarget &lcd) const {
   return _h; // We always flex to the height of our container.
 }
 
 void VScroll::setItemHeight(int16_t newItemHeight) {
-  _itemHeight = newItemHeight;
-  if (_itemHeight < 0) {
-    _itemHeight = DEFAULT_VSCROLL_ITEM_HEIGHT;
+  if (newItemHeight == FLEX) {
+    // Measure every entry again at the next layout.
+    _flexHeights = true;
+    _enableHeightIndex();
+    if (NULL != _heights) {
+      _numUnmeasured = 0;
+      _firstUnmeasured = _numEntries;
+      for (size_t i = 0; i < _numEntries; i++) {
+        _heights[i] = _newEntryHeight(i, _entries[i]);
+      }
+      _rebuildHeightIndex();
+    }
+  } else {
+    _itemHeight = newItemHeight;
+    if (_itemHeight < 0) {
+      _itemHeight = DEFAULT_VSCROLL_ITEM_HEIGHT;
+    }
+    _flexHeights = false;
+    _freeHeightIndex(); // All entries are the same height again.
+  }
+
+  _drawnTopIdx = VSCROLL_NO_ENTRY;
+  invalidateLayout();
+}
+
+void VScroll::setEntryHeight(size_t idx, int16_t height) {
+  if (NULL != _adapter || idx >= _numEntries) {
+    return; // Entries come from the adapter, or there is no such entry.
   }
 
+  _enableHeightIndex();
+  if (NULL == _entries[idx]) {
+    height = 0; // Empty entries take no space.
+  } else if (height == FLEX) {
+    height = SIZE_NOT_MEASURED; // Measure it at the next layout.
+  } else if (height < 0) {
+    height = 0;
+  }
+
+  _setHeight(idx, height);
+  _drawnTopIdx = VSCROLL_NO_ENTRY;
+  invalidateLayout();
+}
+
+int16_t VScroll::getEntryHeight(size_t idx) const {
+  if (idx >= _numEntries) {
+    return ERROR_INVALID_ELEMENT;
+  }
+
+  return _heightOf(idx);
+}
+
+int32_t VScroll::_entryOffset(size_t idx) const {
+  if (NULL == _heights) {
+    return (int32_t)idx * _itemHeight;
+  }
+
+  return treePrefix(_heightIndex, idx);
+}
+
+/**
+ * Return the index of the entry at 'offset' pixels from the top of the first entry (or
+ * count(), if that's past the last). Entries of zero height are skipped over.
+ */
+size_t VScroll::_findEntry(int32_t offset) const {
+  size_t highBit = 1;
+  while (highBit * 2 <= _numEntries) {
+    highBit *= 2;
+  }
+
+  // Descend the tree, finding the most entries whose heights sum to no more than 'offset'.
+  size_t pos = 0;
+  for (size_t step = highBit; step > 0 && _numEntries > 0; step /= 2) {
+    if (pos + step <= _numEntries && _heightIndex[pos + step] <= offset) {
+      pos += step;
+      offset -= _heightIndex[pos];
+    }
+  }
+
+  return pos;
+}
+
+// Start keeping a height for every entry, all set to _itemHeight (or 0 for empty entries).
+void VScroll::_enableHeightIndex() {
+  if (NULL != _heights || NULL != _adapter) {
+    return; // Already enabled, or the entries come from an adapter.
+  }
+
+  if (NULL != _providedHeights) {
+    _heights = _providedHeights;
+    _heightIndex = _providedHeightIndex;
+  } else {
+    _heights = new int16_t[max(_capacity, (size_t)1)];
+    _heightIndex = new int32_t[_capacity + 1];
+  }
+  for (size_t i = 0; i < _numEntries; i++) {
+    _heights[i] = NULL == _entries[i] ? 0 : _itemHeight;
+  }
+
+  _numUnmeasured = 0;
+  _firstUnmeasured = _numEntries;
+  _rebuildHeightIndex();
+}
+
+void VScroll::_freeHeightIndex() {
+  if (_heights != _providedHeights) {
+    delete [] _heights;
+    delete [] _heightIndex;
+  }
+  _heights = NULL;
+  _heightIndex = NULL;
+  _numUnmeasured = 0;
+  _firstUnmeasured = _numEntries;
+}
+
+// Compute the Fenwick tree over _heights from scratch, in O(n).
+void VScroll::_rebuildHeightIndex() {
+  _heightIndex[0] = 0;
+  for (size_t i = 1; i <= _numEntries; i++) {
+    _heightIndex[i] = _heightOf(i - 1);
+  }
+
+  for (size_t i = 1; i <= _numEntries; i++) {
+    size_t parent = i + lowBit(i);
+    if (parent <= _numEntries) {
+      _heightIndex[parent] += _heightIndex[i];
+    }
+  }
+}
+
+// Return the height to give a newly added entry; FLEX entries are measured at the next layout.
+int16_t VScroll::_newEntryHeight(size_t idx, UIWidget *widget) {
+  if (NULL == widget) {
+    return 0; // Empty entries take no space.
+  } else if (!_flexHeights) {
+    return _itemHeight;
+  }
+
+  _numUnmeasured++;
+  _firstUnmeasured = min(_firstUnmeasured, idx);
+  return SIZE_NOT_MEASURED;
+}
+
+// Set the height of entry 'idx' (or SIZE_NOT_MEASURED), updating the height index.
+void VScroll::_setHeight(size_t idx, int16_t height) {
+  int16_t oldHeight = _heightOf(idx);
+  _numUnmeasured -= _heights[idx] == SIZE_NOT_MEASURED ? 1 : 0;
+  _numUnmeasured += height == SIZE_NOT_MEASURED ? 1 : 0;
+  if (height == SIZE_NOT_MEASURED) {
+    _firstUnmeasured = min(_firstUnmeasured, idx);
+  }
+  _heights[idx] = height;
+  treeAdd(_heightIndex, _numEntries, idx, _heightOf(idx) - oldHeight);
+}
+
+// Measure the content height of every entry not yet measured, starting from the first of them.
+void VScroll::_measureHeights() {
+  if (NULL == _layoutTarget || NULL == _heights) {
+    return; // No way to measure content outside of a Screen.
+  }
+
+  size_t i = _firstUnmeasured;
+  for (; i < _numEntries && _numUnmeasured > 0; i++) {
+    if (_heights[i] == SIZE_NOT_MEASURED) {
+      _setHeight(i, max(_entries[i]->getContentHeight(*_layoutTarget), (int16_t)0));
+    }
+  }
+  _firstUnmeasured = i;
+
+  _drawnTopIdx = VSCROLL_NO_ENTRY; // Entries on screen may have moved.
+}
+
+// Return true if the last entry is already in view, so the list cannot scroll down any further.
+bool VScroll::_atBottom() const {
+  if (NULL == _heights) {
+    return _lastIdx >= _numEntries;
+  }
+
+  // Scroll until the bottom of the last entry is in view, even if it is taller than the others.
+  int16_t x, y, w, h;
+  _getEntryArea(x, y, w, h);
+  return _entryOffset(_numEntries) - _entryOffset(_topIdx) <= h;
+}
+
+/**
+ * Return the furthest entry that scrollDown() can bring to the top: the first entry of the last
+ * full page (or the last entry, if it is taller than a page).
+ */
+size_t VScroll::_maxTopIdx() const {
+  if (_numEntries == 0) {
+    return 0;
+  }
+
+  int16_t x, y, w, h;
+  _getEntryArea(x, y, w, h);
+  size_t idx;
+  if (NULL == _heights) {
+    // Scrolling stops once the last entry is in view, even if only in part.
+    size_t perPage = (max(h, (int16_t)0) + _itemHeight - 1) / max(_itemHeight, (int16_t)1);
+    idx = _numEntries > perPage ? _numEntries - perPage : 0;
+  } else {
+    // Scrolling stops once the bottom of the last entry is in view.
+    int32_t top = _entryOffset(_numEntries) - max(h, (int16_t)0);
+    idx = top <= 0 ? 0 : _findEntry(top);
+    if (top > 0 && _entryOffset(idx) < top) {
+      idx++; // Entry 'idx' starts above the last page.
+    }
+  }
+
+  return min(idx, _numEntries - 1);
+}
+
+/**
+ * Lay out the visible entries right away. Scrolling does not change this widget's own bounding
+ * box, so the entries can be laid out without waiting for the Screen's layout pass; this also
+ * keeps _lastIdx current for the scroll bounds checks.
+ */
+void VScroll::_layoutEntries() {
+  _childPass++; // Entries scrolled out of view lose their parent link.
   cascadeBoundingBox();
 }
 
 bool VScroll::scrollUp() {
   if (_topIdx > 0) {
     _topIdx--;
-    cascadeBoundingBox();
+    _layoutEntries();
     return true;
   }
 
@@ -290,9 +1026,9 @@ bool VScroll::scrollUp() {
 
 // specify the idx of the elem to show @ the top of the scroll box.
 bool VScroll::scrollTo(size_t idx) {
-  if (idx < _entries.size()) {
+  if (idx < _numEntries) {
     _topIdx = idx;
-    cascadeBoundingBox();
+    _layoutEntries();
     return true;
   }
 
@@ -300,22 +1036,26 @@ bool VScroll::scrollTo(size_t idx) {
 }
 
 bool VScroll::scrollDown() {
-  if (_topIdx >= _entries.size() - 1) {
+  if (_laidOutVersion != _layoutVersion) {
+    _layoutEntries(); // Entries may have been added or removed since; update _lastIdx.
+  }
+
+  if (_topIdx >= _numEntries - 1) {
     // Hard limit; cannot scroll past final element in vector.
     return false;
-  } else if (_lastIdx >= _entries.size()) {
+  } else if (_atBottom()) {
     // Should not let user scroll down past the last "full page".
     return false;
   }
 
   // We can continue to scroll.
   _topIdx++;
-  cascadeBoundingBox();
+  _layoutEntries();
   return true;
 }
 
 bool VScroll::setSelection(size_t selId) {
-  if (selId >= _entries.size()) {
+  if (selId >= _numEntries) {
     return _setSelection(NO_SELECTION);
   }
 
@@ -326,13 +1066,13 @@ bool VScroll::setSelection(size_t selId) {
 bool VScroll::selectUp() {
   if (_selectIdx == NO_SELECTION) {
     // Nothing is yet selected. Select the 1st item.
-    if (_entries.size() > 0) {
+    if (_numEntries > 0) {
       return _setSelection(0);
     } else {
       // Impossible to select anything.
       return _setSelection(NO_SELECTION);
     }
-  } else if (_selectIdx > 0 && _selectIdx - 1 < _entries.size()) {
+  } else if (_selectIdx > 0 && _selectIdx - 1 < _numEntries) {
     return _setSelection(_selectIdx - 1);
   }
 
@@ -344,13 +1084,13 @@ bool VScroll::selectUp() {
 bool VScroll::selectDown() {
   if (_selectIdx == NO_SELECTION) {
     // Nothing is yet selected. Select the 1st item.
-    if (_entries.size() > 0) {
+    if (_numEntries > 0) {
       return _setSelection(0);
     } else {
       // Impossible to select anything.
       return _setSelection(NO_SELECTION);
     }
-  } else if (_selectIdx + 1 < _entries.size()) {
+  } else if (_selectIdx + 1 < _numEntries) {
     return _setSelection(_selectIdx + 1);
   }
 
@@ -363,12 +1103,14 @@ bool VScroll::_setSelection(size_t idx) {
   _priorSelectIdx = _selectIdx;
   _selectIdx = idx;
 
-  if (_priorSelectIdx != NO_SELECTION && _entries[_priorSelectIdx] != NULL) {
-    _entries[_priorSelectIdx]->setFocus(false);
+  UIWidget *prior = _priorSelectIdx != NO_SELECTION ? _entry(_priorSelectIdx) : NULL;
+  if (prior != NULL) {
+    prior->setFocus(false);
   }
 
-  if (_selectIdx != NO_SELECTION && _entries[_selectIdx] != NULL) {
-    _entries[_selectIdx]->setFocus(true);
+  UIWidget *selected = _selectIdx != NO_SELECTION ? _entry(_selectIdx) : NULL;
+  if (selected != NULL) {
+    selected->setFocus(true);
   }
 
   return idx != NO_SELECTION;
@@ -379,5 +1121,5 @@ UIWidget* VScroll::getSelected() const {
     return NULL;
   }
 
-  return _entries[_selectIdx];
+  return _entry(_selectIdx);
 }
@@ -3,7 +3,6 @@
 #ifndef _UIW_VSCROLL_H
 #define _UIW_VSCROLL_H
 
-#include <tiny-collections.h>
 #include "screen.h"
 
 constexpr int16_t VSCROLL_SCROLLBAR_W = 12; // width of the rendered scrollbar itself
@@ -13,11 +12,35 @@ constexpr int16_t DEFAULT_VSCROLL_ITEM_HEIGHT = 16;
 
 // constant signaling that no element of a VScroll is selected.
 constexpr size_t NO_SELECTION = 0xFFFFFFFF;
+// Returned by VScroll::indexOf() for a widget that is not in the list.
+constexpr size_t VSCROLL_NO_ENTRY = 0xFFFFFFFF;
+// Thumb position of a VScroll scrollbar that is not known to be on screen.
+constexpr int16_t VSCROLL_THUMB_NOT_DRAWN = -32768;
 
 // Render flags specific to the VScroll widget.
 constexpr uint32_t RF_VSCROLL_CONTENT   = 0x10000 | RF_WIDGET_SPECIFIC | RF_NO_BACKGROUNDS;
 constexpr uint32_t RF_VSCROLL_SCROLLBAR = 0x20000 | RF_WIDGET_SPECIFIC | RF_NO_BACKGROUNDS;
 constexpr uint32_t RF_VSCROLL_SELECTED  = 0x40000 | RF_WIDGET_SPECIFIC | RF_NO_BACKGROUNDS;
+// Redraw after scrolling: move the rows already on screen and render only the newly exposed ones,
+// and move the scrollbar's thumb. See VScroll::render().
+constexpr uint32_t RF_VSCROLL_SHIFT     = 0x80000 | RF_WIDGET_SPECIFIC | RF_NO_BACKGROUNDS;
+
+/**
+ * Supplies the entries of a virtualized VScroll (see VScroll::setAdapter()). Rather than holding a
+ * widget for every entry, the VScroll holds a small pool of row widgets for its visible slots, and
+ * asks the adapter to bind each one to the entry it currently shows.
+ */
+class VScrollAdapter {
+public:
+  VScrollAdapter() {};
+  virtual ~VScrollAdapter() {};
+
+  // Return the number of entries in the list.
+  virtual size_t count() = 0;
+  // Set up 'row' (one of the row widgets given to setAdapter()) to display entry 'idx', e.g. by
+  // calling setText() on it.
+  virtual void bindRow(UIWidget *row, size_t idx) = 0;
+};
 
 /**
  * A container for a variable number of entries, displayed with a scrollbar.
@@ -28,40 +51,78 @@ constexpr uint32_t RF_VSCROLL_SELECTED  = 0x40000 | RF_WIDGET_SPECIFIC | RF_NO_B
  *
  * This widget does not work especially well with the BORDER_ROUNDED border style, as
  * the scrollbar expects to encroach on a rectilinear border (if specified).
+ *
+ * The list of entries grows on the heap as needed; FixedVScroll holds a fixed number of entries
+ * within the object itself instead. For long lists, setAdapter() virtualizes the VScroll so it
+ * needs memory only for the rows on screen.
+ *
+ * Every entry is setItemHeight() pixels tall, unless given its own height with setEntryHeight(),
+ * or measured to fit its content with setItemHeight(FLEX). Entries of differing heights are kept in
+ * a prefix-sum index (allocated on the heap, unless the list is a FixedVScroll or was built by a
+ * WidgetArena), so finding where an entry lies, or which entry lies at a given point, takes time
+ * logarithmic in the number of entries.
  */
 class VScroll : public UIWidget {
 public:
-  VScroll(): UIWidget(), _entries(),
-      _topIdx(0), _lastIdx(0), _selectIdx(NO_SELECTION), _priorSelectIdx(NO_SELECTION),
-      _itemHeight(DEFAULT_VSCROLL_ITEM_HEIGHT),
-      _scrollbar_bg_color(TFT_BLACK),
-      _content_bg_color(TRANSPARENT_COLOR) {};
+  VScroll(): VScroll(NULL, 0) {};
+  ~VScroll();
 
-  // Add the specified widget to the end of the list.
-  void add(UIWidget *widget) { _entries.push_back(widget); cascadeBoundingBox(); };
+  // Add the specified widget to the end of the list. Returns false if the list is full, or if the
+  // entries come from an adapter.
+  bool add(UIWidget *widget) { return insert(_numEntries, &widget, 1); };
+  // Insert 'count' widgets before entry 'idx' (or at the end, if idx >= count()), shifting the
+  // list once. Returns false if they do not fit, or if the entries come from an adapter.
+  bool insert(size_t idx, UIWidget *const *widgets, size_t count);
+  bool insert(size_t idx, UIWidget *widget) { return insert(idx, &widget, 1); };
   // Remove the specified widget from the list.
-  void remove(UIWidget *widget);
-  // Remove all widgets from the list.
-  void clear() {
-    _entries.clear();
-    _selectIdx = NO_SELECTION;
-    _priorSelectIdx = NO_SELECTION;
-    cascadeBoundingBox();
-  };
+  void remove(UIWidget *widget) { removeAt(indexOf(widget)); };
+  // Remove 'count' entries starting at entry 'idx', shifting the list once.
+  void removeAt(size_t idx, size_t count = 1);
+  // Return the index of 'widget' in the list (or, with an adapter, of the entry that row 'widget'
+  // shows), or VSCROLL_NO_ENTRY. Visible entries are found in time proportional to the number on
+  // screen; others by searching the whole list.
+  size_t indexOf(const UIWidget *widget) const;
+  // Remove all widgets from the list, or detach the adapter.
+  void clear() { setAdapter(NULL, NULL, 0); };
+
+  /**
+   * Show the entries supplied by 'adapter', rather than a list of widgets. The 'numRows' widgets
+   * in 'rows' are recycled for whichever entries are visible: as the list scrolls, each row is
+   * rebound (with adapter->bindRow()) to the entry it moves to. Provide at least as many rows as
+   * fit in the VScroll at once; entries beyond the last row are not shown. Neither the adapter nor
+   * the rows are owned by the VScroll.
+   *
+   * Any entries added with add() are removed. Pass a NULL adapter to go back to holding a list.
+   */
+  void setAdapter(VScrollAdapter *adapter, UIWidget **rows, size_t numRows);
+  VScrollAdapter *getAdapter() const { return _adapter; };
+  // Re-read the adapter's count() and bind every visible row again, e.g. after the entries change.
+  // If there are now fewer entries, scrolls up as needed to keep the last page full.
+  void dataChanged();
 
   // Return number of entries in the list.
-  size_t count() const { return _entries.size(); };
+  size_t count() const { return _numEntries; };
   size_t position() const { return _topIdx; }; // idx of the elem @ the top of the viewport
   size_t bottomIdx() const { return _lastIdx; }; // idx of the elem @ the bottom of the viewport.
 
-  virtual void render(TFT_eSPI &lcd, uint32_t renderFlags);
+  /**
+   * Render the VScroll. With RF_VSCROLL_SHIFT, the content area is assumed to still show what was
+   * last drawn there, as of an earlier scroll position; those pixels are moved by the distance
+   * scrolled since (with DrawTarget::copyRect()) and only the newly exposed rows are rendered. If
+   * that's not possible or not worth it (no content background is set, the target cannot move
+   * pixels cheaply, the list changed or scrolled by a page or more, etc.) the whole content area
+   * is redrawn instead.
+   * Likewise, only the part of the scrollbar's thumb that moved is repainted, unless the scrollbar
+   * has changed since it was last drawn.
+   */
+  virtual void render(DrawTarget &lcd, uint32_t renderFlags);
   // Render the up-facing scrollbar chevron
-  void renderScrollUp(TFT_eSPI &lcd, bool btnActive, uint32_t renderFlags=0);
+  void renderScrollUp(DrawTarget &lcd, bool btnActive, uint32_t renderFlags=0);
   // Render the down-facing scrollbar chevron
-  void renderScrollDown(TFT_eSPI &lcd, bool btnActive, uint32_t renderFlags=0);
+  void renderScrollDown(DrawTarget &lcd, bool btnActive, uint32_t renderFlags=0);
   virtual void cascadeBoundingBox();
-  virtual int16_t getContentWidth(TFT_eSPI &lcd) const;
-  virtual int16_t getContentHeight(TFT_eSPI &lcd) const;
+  virtual int16_t getContentWidth(DrawTarget &lcd) const;
+  virtual int16_t getContentHeight(DrawTarget &lcd) const;
 
   bool scrollUp(); // scroll 1 element higher.
   bool scrollTo(size_t idx); // specify the idx of the elem to show @ the top of the scroll box.
@@ -71,37 +132,168 @@ public:
   bool selectUp(); // select the element 1 above the current one.
   bool selectDown(); // select the element 1 lower than the current one.
   size_t selectIdx() const { return _selectIdx; }; // return idx of selected element.
-  UIWidget* getSelected() const; // Return the selected elem (or NULL if none).
+  // Return the selected elem (or NULL if none). With an adapter, this is the row bound to the
+  // selected entry, or NULL if it is not visible.
+  UIWidget* getSelected() const;
 
-  // Specify height available to each entry to render within.
+  // Specify height available to each entry to render within, or FLEX to size each entry to fit
+  // its content (as measured once, when it is first laid out). This replaces any heights given to
+  // individual entries with setEntryHeight().
   void setItemHeight(int16_t newItemHeight);
-  int16_t getItemHeight() const { return _itemHeight; };
+  int16_t getItemHeight() const { return _flexHeights ? FLEX : _itemHeight; };
+  // Specify the height of entry 'idx' alone, or FLEX to size it to fit its content (e.g. to measure
+  // it again after the content changes). Entries added later get the setItemHeight() height. Not
+  // supported with an adapter.
+  void setEntryHeight(size_t idx, int16_t height);
+  // Return the height of entry 'idx', as of the last layout.
+  int16_t getEntryHeight(size_t idx) const;
 
-  virtual bool redrawChildWidget(UIWidget *widget, TFT_eSPI &lcd, uint32_t renderFlags=0);
+  virtual bool redrawChildWidget(UIWidget *widget, DrawTarget &lcd, uint32_t renderFlags=0);
+  virtual UIWidget *getChildContaining(UIWidget *widget) const;
+  virtual UIWidget *getChildAt(int16_t x, int16_t y) const;
+  virtual uint16_t getChildBackground(uint32_t renderFlags) const { return _content_bg_color; };
+  virtual bool isOpaque(uint32_t renderFlags) const { return false; };
 
   void setContentBackground(uint16_t color) { _content_bg_color = color; };
   void setScrollbarBackground(uint16_t color) { _scrollbar_bg_color = color; };
 
 protected:
-  void _renderScrollbar(TFT_eSPI &lcd, uint32_t renderFlags);
-  void _renderContentArea(TFT_eSPI &lcd, uint32_t renderFlags);
+  friend class WidgetArena;
+  // Hold up to 'capacity' entries in the caller-provided array 'entries'; if 'entries' is NULL,
+  // the list is allocated on the heap and grows as needed. If 'heights' (of 'capacity' values) and
+  // 'heightIndex' (of 'capacity' + 1) are also provided, entry heights are indexed there rather
+  // than on the heap.
+  VScroll(UIWidget **entries, size_t capacity, int16_t *heights=NULL,
+      int32_t *heightIndex=NULL): UIWidget(),
+      _entries(entries), _numEntries(0), _capacity(capacity), _fixedCapacity(entries != NULL),
+      _adapter(NULL), _rows(NULL), _numRows(0), _boundTop(0), _boundEnd(0),
+      _topIdx(0), _lastIdx(0), _laidOutVersion(0), _selectIdx(NO_SELECTION), _priorSelectIdx(NO_SELECTION),
+      _visibleGaps(false), _drawnTopIdx(VSCROLL_NO_ENTRY),
+      _itemHeight(DEFAULT_VSCROLL_ITEM_HEIGHT), _flexHeights(false),
+      _heights(NULL), _heightIndex(NULL), _providedHeights(heights), _providedHeightIndex(heightIndex),
+      _numUnmeasured(0), _firstUnmeasured(0),
+      _drawnThumbY(VSCROLL_THUMB_NOT_DRAWN), _drawnScrollbarColor(0), _drawnScrollbarBg(0),
+      _upActive(false), _downActive(false),
+      _scrollbar_bg_color(TFT_BLACK),
+      _content_bg_color(TRANSPARENT_COLOR) {
+    _drawnArea.x = 0;
+    _drawnArea.y = 0;
+    _drawnArea.w = 0;
+    _drawnArea.h = 0;
+    _drawnScrollbar = _drawnArea;
+  };
+
+  void _renderScrollbar(DrawTarget &lcd, uint32_t renderFlags);
+  bool _moveScrollbarThumb(DrawTarget &lcd, uint32_t renderFlags);
+  int16_t _thumbY() const;
+  void _renderContentArea(DrawTarget &lcd, uint32_t renderFlags);
+  bool _shiftContentArea(DrawTarget &lcd, uint32_t renderFlags);
+  void _renderRows(DrawTarget &lcd, uint32_t renderFlags, int16_t top, int16_t bottom);
 
 private:
   bool _setSelection(size_t idx);
+  void _getEntryArea(int16_t &x, int16_t &y, int16_t &w, int16_t &h) const;
+  void _layoutEntries();
+  bool _growEntries(size_t minCapacity);
+  UIWidget *_bindRow(size_t idx);
+
+  void _enableHeightIndex();
+  void _freeHeightIndex();
+  void _rebuildHeightIndex();
+  void _measureHeights();
+  int16_t _newEntryHeight(size_t idx, UIWidget *widget);
+  void _setHeight(size_t idx, int16_t height);
+  size_t _findEntry(int32_t offset) const;
+  bool _atBottom() const;
+  size_t _maxTopIdx() const;
+
+  // Return the height entry 'idx' is laid out with.
+  int16_t _heightOf(size_t idx) const {
+    if (NULL == _heights) {
+      return _itemHeight;
+    }
 
-  tc::vector<UIWidget*> _entries;
+    return _heights[idx] == SIZE_NOT_MEASURED ? _itemHeight : _heights[idx];
+  };
+
+  // Return the distance from the top of the first entry to the top of entry 'idx'.
+  int32_t _entryOffset(size_t idx) const;
+
+  // Return the widget showing entry 'idx', or NULL if there is none. With an adapter, only the
+  // visible entries have one.
+  UIWidget *_entry(size_t idx) const {
+    if (NULL == _adapter) {
+      return _entries[idx];
+    }
+
+    return (idx >= _boundTop && idx < _boundEnd) ? _rows[idx % _numRows] : NULL;
+  };
+
+  UIWidget **_entries;
+  size_t _numEntries;
+  size_t _capacity; // Length of the _entries array.
+  bool _fixedCapacity; // True if _entries was provided by a subclass, and cannot grow.
+
+  VScrollAdapter *_adapter; // Supplies the entries, if set; then _entries is unused.
+  UIWidget **_rows; // Row widgets recycled for the visible entries; entry i uses _rows[i % _numRows].
+  size_t _numRows;
+  size_t _boundTop; // Entries [_boundTop, _boundEnd) are bound to their rows.
+  size_t _boundEnd;
 
   size_t _topIdx; // Index of the first element to display.
   size_t _lastIdx; // Index of the last visible element.
+  uint32_t _laidOutVersion; // UIWidget::_layoutVersion as of the last time entries were laid out.
   size_t _selectIdx; // Index of a selected element, if any (or NO_SELECTION otherwise).
   size_t _priorSelectIdx; // Index of previously-selected element, if any (or NO_SELECTION).
                           // Tracked so we can re-render this element w/o focus when we re-render
                           // the newly-focused _selectIdx entry.
+  bool _visibleGaps; // True if a NULL entry is visible, so rows are not evenly spaced.
+
+  // The content area as of the last time it was drawn in full, and the index of the element then
+  // at its top (or VSCROLL_NO_ENTRY if what's on screen is unknown). Used by RF_VSCROLL_SHIFT.
+  UIRect _drawnArea;
+  size_t _drawnTopIdx;
 
-  int16_t _itemHeight; // Fixed height for all elements.
+  int16_t _itemHeight; // Height for all elements, unless they have their own in _heights.
+  bool _flexHeights; // True if elements are sized to fit their content.
+
+  // With variable heights, the height of each element, or SIZE_NOT_MEASURED for a FLEX element
+  // not yet measured (laid out with _itemHeight meanwhile); NULL if all are _itemHeight tall.
+  int16_t *_heights;
+  // Fenwick tree over _heights, for prefix sums in O(log n): _heightIndex[i] (1-based) holds the sum
+  // of the i & -i heights ending with _heights[i - 1]. Has room for _capacity + 1 sums.
+  int32_t *_heightIndex;
+  // Caller-provided arrays to use for _heights and _heightIndex, or NULL to allocate them.
+  int16_t *_providedHeights;
+  int32_t *_providedHeightIndex;
+  size_t _numUnmeasured; // Number of SIZE_NOT_MEASURED values in _heights.
+  size_t _firstUnmeasured; // No value in _heights before this index is SIZE_NOT_MEASURED.
+
+  // The scrollbar as of the last time it was drawn in full, and the y position of its thumb since
+  // (or VSCROLL_THUMB_NOT_DRAWN if what's on screen is unknown). Used by RF_VSCROLL_SHIFT.
+  UIRect _drawnScrollbar;
+  int16_t _drawnThumbY;
+  uint16_t _drawnScrollbarColor;
+  uint16_t _drawnScrollbarBg;
+  bool _upActive; // True if the scroll-up chevron was last drawn active.
+  bool _downActive; // True if the scroll-down chevron was last drawn active.
   uint16_t _scrollbar_bg_color;
   uint16_t _content_bg_color;
 };
 
+/**
+ * A VScroll with room for up to N entries held within the object itself, so adding entries never
+ * allocates memory. It behaves just like a VScroll, except that add() returns false once it holds
+ * N entries. Entry heights are indexed within the object too, at 6 more bytes per entry.
+ */
+template<size_t N> class FixedVScroll: public VScroll {
+public:
+  FixedVScroll(): VScroll(_entryStore, N, _heightStore, _heightIndexStore) {};
+
+private:
+  UIWidget *_entryStore[N];
+  int16_t _heightStore[N];
+  int32_t _heightIndexStore[N + 1];
+};
 
 #endif // _UIW_VSCROLL_H
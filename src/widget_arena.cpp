@@ -0,0 +1,127 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#include "uiwidgets.h"
+
+WidgetArena::WidgetArena(void *buffer, size_t size): _buffer((uint8_t*)buffer), _size(size),
+    _used(0), _highWater(0), _overflowed(false), _ownsBuffer(false), _lastObject(NULL) {
+}
+
+WidgetArena::WidgetArena(size_t size): _buffer(new uint8_t[size]), _size(size),
+    _used(0), _highWater(0), _overflowed(false), _ownsBuffer(true), _lastObject(NULL) {
+}
+
+WidgetArena::~WidgetArena() {
+  reset();
+  if (_ownsBuffer) {
+    delete [] _buffer;
+  }
+}
+
+void *WidgetArena::allocate(size_t size, size_t align) {
+  // Round the start of the allocation up to the next multiple of 'align' (a power of 2) within
+  // the buffer.
+  uintptr_t base = (uintptr_t)_buffer;
+  uintptr_t start = (base + _used + align - 1) & ~(uintptr_t)(align - 1);
+  size_t end = start - base + size;
+  if (end > _size) {
+    _overflowed = true;
+    return NULL;
+  }
+
+  _used = end;
+  _highWater = max(_highWater, _used);
+  memset((void*)start, 0, size);
+  return (void*)start;
+}
+
+// Allocate space for an object, preceded by the record used to destroy it at reset().
+void *WidgetArena::_allocObject(size_t size, size_t align, void (*destroy)(void *obj)) {
+  size_t mark = _used;
+  ObjectRecord *record = (ObjectRecord*)allocate(sizeof(ObjectRecord), alignof(ObjectRecord));
+  void *obj = NULL == record ? NULL : allocate(size, align);
+  if (NULL == obj) {
+    _used = mark; // Don't leave an unused record behind.
+    return NULL;
+  }
+
+  record->prev = _lastObject;
+  record->destroy = destroy;
+  record->obj = obj;
+  _lastObject = record;
+  return obj;
+}
+
+// For each container, if any of its parts do not fit, give back the parts that did.
+
+Rows *WidgetArena::createRows(uint16_t numRows) {
+  size_t mark = _used;
+  numRows = max(numRows, (uint16_t)1);
+  UIWidget **elements = (UIWidget**)allocate(numRows * sizeof(UIWidget*), alignof(UIWidget*));
+  int16_t *heights = NULL == elements ? NULL
+      : (int16_t*)allocate(2 * numRows * sizeof(int16_t), alignof(int16_t));
+  Rows *rows = NULL == heights ? NULL : create<Rows>(numRows, elements, heights, numRows);
+  if (NULL == rows) {
+    _used = mark;
+  }
+
+  return rows;
+}
+
+Cols *WidgetArena::createCols(uint16_t numCols) {
+  size_t mark = _used;
+  numCols = max(numCols, (uint16_t)1);
+  UIWidget **elements = (UIWidget**)allocate(numCols * sizeof(UIWidget*), alignof(UIWidget*));
+  int16_t *widths = NULL == elements ? NULL
+      : (int16_t*)allocate(2 * numCols * sizeof(int16_t), alignof(int16_t));
+  Cols *cols = NULL == widths ? NULL : create<Cols>(numCols, elements, widths, numCols);
+  if (NULL == cols) {
+    _used = mark;
+  }
+
+  return cols;
+}
+
+Grid *WidgetArena::createGrid(uint16_t numRows, uint16_t numCols) {
+  size_t mark = _used;
+  numRows = max(numRows, (uint16_t)1);
+  numCols = max(numCols, (uint16_t)1);
+  UIWidget **cells = (UIWidget**)allocate((size_t)numRows * numCols * sizeof(UIWidget*),
+      alignof(UIWidget*));
+  int16_t *tracks = NULL == cells ? NULL
+      : (int16_t*)allocate((2 * ((size_t)numRows + numCols) + 2) * sizeof(int16_t),
+      alignof(int16_t));
+  Grid *grid = NULL == tracks ? NULL : create<Grid>(numRows, numCols, cells, tracks);
+  if (NULL == grid) {
+    _used = mark;
+  }
+
+  return grid;
+}
+
+VScroll *WidgetArena::createVScroll(size_t capacity) {
+  size_t mark = _used;
+  capacity = max(capacity, (size_t)1);
+  UIWidget **entries = (UIWidget**)allocate(capacity * sizeof(UIWidget*), alignof(UIWidget*));
+  int16_t *heights = NULL == entries ? NULL
+      : (int16_t*)allocate(capacity * sizeof(int16_t), alignof(int16_t));
+  int32_t *heightIndex = NULL == heights ? NULL
+      : (int32_t*)allocate((capacity + 1) * sizeof(int32_t), alignof(int32_t));
+  VScroll *vscroll = NULL == heightIndex ? NULL
+      : create<VScroll>(entries, capacity, heights, heightIndex);
+  if (NULL == vscroll) {
+    _used = mark;
+  }
+
+  return vscroll;
+}
+
+void WidgetArena::reset() {
+  // Destroy objects in the reverse order of their construction.
+  while (_lastObject != NULL) {
+    ObjectRecord *record = _lastObject;
+    _lastObject = record->prev;
+    record->destroy(record->obj);
+  }
+
+  _used = 0;
+}
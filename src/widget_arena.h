@@ -0,0 +1,77 @@
+// (c) Copyright 2022 Aaron Kimball
+
+#ifndef __UIW_WIDGET_ARENA_H
+#define __UIW_WIDGET_ARENA_H
+
+#include <new>
+#include <utility>
+
+/**
+ * Constructs widgets (and the child lists of the containers among them) out of one preallocated
+ * buffer, and destroys them all at once with reset(). Build a whole screen's widget tree in an
+ * arena, and reset() the arena when the screen is dismissed: this is faster than allocating each
+ * widget with `new`, and never fragments the heap.
+ *
+ * Objects are destroyed in the reverse order they were created. Memory is never reclaimed
+ * individually; it is all reused after reset(). Creation methods return NULL if the arena is out
+ * of space; use getHighWater() to size the arena for a given screen.
+ */
+class WidgetArena {
+public:
+  // Use 'size' bytes at 'buffer' for the arena. The buffer must outlive the arena.
+  WidgetArena(void *buffer, size_t size);
+  // Allocate a 'size'-byte buffer for the arena, once.
+  WidgetArena(size_t size);
+  ~WidgetArena();
+
+  // Construct a T within the arena with the given constructor arguments, or return NULL if there
+  // is no room left.
+  template<typename T, typename... Args> T *create(Args&&... args) {
+    void *mem = _allocObject(sizeof(T), alignof(T), _destroy<T>);
+    return NULL == mem ? NULL : new (mem) T(std::forward<Args>(args)...);
+  };
+
+  // Create containers whose lists of children are also allocated within the arena.
+  Rows *createRows(uint16_t numRows);
+  Cols *createCols(uint16_t numCols);
+  // Cannot grow beyond 'numRows' x 'numCols' cells.
+  Grid *createGrid(uint16_t numRows, uint16_t numCols);
+  // Holds at most 'capacity' entries. Its index of entry heights is in the arena too.
+  VScroll *createVScroll(size_t capacity);
+
+  // Allocate 'size' zeroed bytes with the given alignment, or return NULL if there is no room.
+  void *allocate(size_t size, size_t align);
+
+  // Destroy every object created in the arena, and free all of its memory for reuse.
+  void reset();
+
+  size_t getCapacity() const { return _size; }; // Size of the arena's buffer in bytes.
+  size_t getUsed() const { return _used; }; // Bytes allocated since the last reset().
+  // Most bytes ever allocated at once (since construction, or clearHighWater()).
+  size_t getHighWater() const { return _highWater; };
+  // Return true if an allocation has failed for lack of space (since construction, or
+  // clearHighWater()).
+  bool hasOverflowed() const { return _overflowed; };
+  void clearHighWater() { _highWater = _used; _overflowed = false; };
+
+private:
+  // Header recorded ahead of each object, linking it into the list of objects to destroy.
+  struct ObjectRecord {
+    ObjectRecord *prev; // Previously created object, or NULL.
+    void (*destroy)(void *obj);
+    void *obj;
+  };
+
+  template<typename T> static void _destroy(void *obj) { static_cast<T*>(obj)->~T(); };
+  void *_allocObject(size_t size, size_t align, void (*destroy)(void *obj));
+
+  uint8_t *_buffer;
+  size_t _size;
+  size_t _used;
+  size_t _highWater;
+  bool _overflowed;
+  bool _ownsBuffer;
+  ObjectRecord *_lastObject; // Most recently created object; destroyed first.
+};
+
+#endif // __UIW_WIDGET_ARENA_H